@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * arena.c   - c file for the shared node arena
+ *           - written by Ben Lindow
+ *
+ *    carve(size_t, Arena *);
+ *      - takes the next bytes of the current block, starting a new block when
+ *      - it runs out; a key too big to share a block gets one of its own
+ *      - returns the bytes, aligned for a pointer
+ *      - usage example: Node* n = carve(sizeof(Node), pool);
+ */
+
+static void* carve(size_t, Arena *);
+
+Arena* initArena(void)
+{
+    Arena* pool = allocate(sizeof(Arena));
+
+    pool->next = NULL;
+    pool->left = 0;
+    pool->spare = NULL;
+    pool->blocks = 0;
+    pool->nodes = 0;
+    pool->spares = 0;
+    pool->keyBytes = 0;
+    return pool;
+}
+
+Node* arenaNode(char* str, Arena* pool)
+{
+    Node* n;
+    size_t len;
+
+    if (pool->spare)
+    {
+        n = pool->spare;
+        pool->spare = n->left;
+        pool->spares--;
+    }
+    else
+        n = carve(sizeof(Node), pool);
+    pool->nodes++;
+
+    n->freq = 1;
+    n->lheight = 0;
+    n->rheight = 0;
+    n->height = 1;
+    if (str && (len = strlen(str)) >= NODE_INLINE)
+    {
+        n->data = carve(len + 1, pool);
+        memcpy(n->data, str, len + 1);
+        pool->keyBytes += len + 1;
+    }
+    else
+    {
+        strcpy(n->key, str ? str : "");
+        n->data = n->key;
+    }
+    n->left = NULL;
+    n->right = NULL;
+    n->parent = NULL;
+    n->fav = NULL;
+
+    return n;
+}
+
+void releaseNode(Node* n, Arena* pool)
+{
+    //The free list is chained through left, the rest of the node is garbage
+    n->left = pool->spare;
+    pool->spare = n;
+    pool->spares++;
+    pool->nodes--;
+}
+
+void reportArena(Arena* pool, FILE* out)
+{
+    fprintf(out, "Arena Nodes: %ld live, %ld spare, %zu bytes each\n", pool->nodes, pool->spares, sizeof(Node));
+    fprintf(out, "Arena Key Bytes: %ld\n", pool->keyBytes);
+    fprintf(out, "Arena Blocks: %ld of %d bytes\n", pool->blocks, ARENA_BLOCK);
+}
+
+static void* carve(size_t size, Arena* pool)
+{
+    void* at;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (size > ARENA_BLOCK / 4)
+        return allocate(size);
+    if (size > pool->left)
+    {
+        pool->next = allocate(ARENA_BLOCK);
+        pool->left = ARENA_BLOCK;
+        pool->blocks++;
+    }
+    at = pool->next;
+    pool->next += size;
+    pool->left -= size;
+    return at;
+}
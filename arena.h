@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "node.h"
+
+/* VERSION 1.0
+ *
+ * arena.h   - header file for the shared node arena
+ *           - written by Ben Lindow
+ *
+ *    One allocator for the nodes and keys of many trees.  Nodes and keys
+ *    are carved one after another out of ARENA_BLOCK byte blocks, so the
+ *    nodes of every tree sit densely together instead of each paying for
+ *    its own malloc header, and a node a tree lets go of is kept on a free
+ *    list for the next node any tree makes.  Key bytes are not reused.
+ *    An arena is not locked, so only one thread may use it at a time.
+ *
+ *    initArena(void);
+ *      - constructor for an empty arena
+ *      - returns a malloc'd arena object
+ *      - usage example: Arena* pool = initArena();
+ *
+ *    arenaNode(char *, Arena *);
+ *      - makes a node as createNode does, from the arena, copying a key too long
+ *      - to inline into the arena as well, so the caller may always free the string
+ *      - returns the node
+ *      - usage example: Node* n = arenaNode(str, pool);
+ *
+ *    releaseNode(Node *, Arena *);
+ *      - takes back a node that is no longer in any tree, for the next arenaNode
+ *      - usage example: releaseNode(n, pool);
+ *
+ *    reportArena(Arena *, FILE *);
+ *      - prints the nodes live and spare, the key bytes and the blocks taken
+ *      - usage example: reportArena(pool, stdout);
+ *
+ */
+
+#define ARENA_BLOCK (1 << 20)
+
+typedef struct Arena
+{
+    char* next;
+    size_t left;
+    Node* spare;
+
+    long blocks;
+    long nodes;
+    long spares;
+    long keyBytes;
+} Arena;
+
+extern Arena* initArena(void);
+extern Node* arenaNode(char *, Arena *);
+extern void releaseNode(Node *, Arena *);
+extern void reportArena(Arena *, FILE *);
+
+#endif
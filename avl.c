@@ -80,13 +80,9 @@
  *      - returns - if a node is left heavy, + if right, NULL if balanced
  *      - usage example: char heav = heavy(node);
 
- *    getStats(AVL *);
- *      - uses tree traversal to gather information and store in tree
- *      - usage example: getStats(tree);
-
- *    printNode(Node *);
+ *    printNode(Node *, FILE *);
  *      - prints node information in a specific format
- *      - usage example: printNode(node);
+ *      - usage example: printNode(node, out);
  
  *    swapNodes(Node *, Node *);
  *      - swaps the data betwwen two nodes
@@ -114,6 +110,137 @@
  *    trimLeaf(Node *);
  *      - generic prune function to remove leaf from tree
  *      - usage example: trimLeaf(n);
+
+ *    noteReads(int, AVL *);
+ *      - counts lookups since the last change and freezes the tree once they pay for it
+ *      - usage example: noteReads(1, tree);
+
+ *    printFrozen(char *, AVL *);
+ *      - prints the frequency of a key from the frozen index
+ *      - usage example: printFrozen(str, tree);
+
+ *    removeKey(Node *, AVL *);
+ *      - deleetAVL past the empty tree and filter checks
+ *      - usage example: removeKey(node, tree);
+
+ *    mayHave(char *, AVL *);
+ *      - asks the filter, if any, whether a key could be in the tree
+ *      - returns 0 if the key is certainly absent, else 1
+ *      - usage example: if(!mayHave(str, tree)) ...
+
+ *    missed(AVL *);
+ *      - tells the filter, if any, that a key it passed was not in the tree
+ *      - usage example: missed(tree);
+
+ *    lookupBatch(char **, int, Node **, AVL *);
+ *      - findBatchAVL on only the keys the filter passes
+ *      - usage example: lookupBatch(keys, count, found, tree);
+
+ *    fill(Node *, Bloom *);
+ *      - adds every key in a subtree to a filter
+ *      - usage example: fill(tree->root, filter);
+
+ *    markDirty(Node *, AVL *);
+ *      - climbs the heights above a relaxed insert as fixup does, but marks the first
+ *      - node out of balance instead of rotating, settling every RELAX_BATCH inserts
+ *      - usage example: markDirty(n, tree);
+
+ *    markPath(Node *, AVL *);
+ *      - marks a node and its ancestors, height 0, up to the first one marked,
+ *      - and zeroes each marked node's side height in its parent
+ *      - usage example: markPath(p, tree);
+
+ *    settle(Node *);
+ *      - rebalances the marked nodes of a subtree, children first, from their stored
+ *      - side heights, joining only a node whose settled subtrees are out of balance
+ *      - returns the root of the balanced subtree
+ *      - usage example: tree->root = settle(tree->root);
+
+ *    collectLive(Node *, Node **, int *, AVL *);
+ *      - gathers the live nodes of a subtree in key order, freeing its tombstones
+ *      - usage example: collectLive(tree->root, nodes, &count, tree);
+
+ *    merge(Merge *);
+ *      - unions the two subtrees of a merge, keeping the first's nodes and adding in
+ *      - the frequencies of the second's matching keys, forking the left half onto
+ *      - its own thread while spawn is above zero
+ *      - usage example: merge(&m);
+
+ *    mergeTask(void *);
+ *      - thread body for the forked half of a merge
+ *      - usage example: pthread_create(&t, NULL, mergeTask, &left);
+
+ *    split(Node *, char *, Node **, Node **, Node **);
+ *      - splits a subtree into the keys below a key, the node holding it, if any,
+ *      - and the keys above it, each an AVL subtree
+ *      - usage example: split(root, str, &l, &same, &r);
+
+ *    join(Node *, Node *, Node *);
+ *      - joins two AVL subtrees whose keys lie below and above a middle node
+ *      - in time proportional to their difference in height
+ *      - returns the root of the joined subtree
+ *      - usage example: Node* t = join(l, k, r);
+
+ *    joinRight(Node *, Node *, Node *), joinLeft(Node *, Node *, Node *);
+ *      - join when the left, or right, subtree is more than one level taller
+ *      - returns the root of the joined subtree
+ *      - usage example: Node* t = joinRight(l, k, r);
+
+ *    link(Node *, Node *, Node *);
+ *      - makes l and r the children of k and recomputes k's balance
+ *      - returns k
+ *      - usage example: Node* t = link(l, k, r);
+
+ *    turnLeft(Node *), turnRight(Node *);
+ *      - rotates a detached subtree about its root
+ *      - returns the new root
+ *      - usage example: Node* t = turnLeft(t);
+
+ *    buildRange(Node **, int);
+ *      - links sorted nodes into a balanced subtree around the middle one
+ *      - returns the root of the subtree
+ *      - usage example: Node* t = buildRange(nodes, count);
+
+ *    buildTask(Task, int, Steal *);
+ *      - scheduler task that places the middle node of a range, hands its left
+ *      - half back to the scheduler and goes on with its right half, down to
+ *      - BUILD_GRAIN nodes, which it builds with buildRange
+ *      - usage example: runSteal(threads, buildTask, first, nodes);
+
+ *    placeNode(Node **, int, Node *);
+ *      - sets the children, parent and heights of the middle node of a range from
+ *      - the range's size alone, so it never waits on the nodes below it
+ *      - returns the middle node
+ *      - usage example: Node* n = placeNode(nodes + lo, count, parent);
+
+ *    rangeHeight(int);
+ *      - returns the height buildRange gives a range of the given size
+ *      - usage example: int h = rangeHeight(count);
+
+ *    joinPair(Node *, Node *);
+ *      - joins two AVL subtrees whose keys lie below and above each other, using
+ *      - the largest key of the first as the middle node
+ *      - returns the root of the joined subtree
+ *      - usage example: Node* t = joinPair(l, r);
+
+ *    splitLast(Node *, Node **);
+ *      - detaches the largest key of a subtree
+ *      - returns the root of the rest, an AVL subtree
+ *      - usage example: l = splitLast(l, &k);
+
+ *    heightOf(Node *);
+ *      - returns the height of a subtree, 0 if empty
+ *      - usage example: int h = heightOf(n);
+
+ *    dropNode(Node *, Arena *);
+ *      - frees a node that is no longer in any tree, and its key if not inline,
+ *      - or gives it back to the arena the tree draws from, if there is one
+ *      - usage example: dropNode(n, tree->arena);
+
+ *    dropTree(Node *, AVL *);
+ *      - frees a detached subtree, taking its keys out of the cache and filter
+ *      - returns the number of nodes freed
+ *      - usage example: int gone = dropTree(mid, tree);
  */
 
 #include "avl.h"
@@ -121,6 +248,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#include "steal.h"
+#include "counters.h"
+
+//Rotations made by joins, which do not know their tree
+static long turns;
+
+typedef struct Merge
+{
+    Node* a;
+    Node* b;
+    int spawn;
+    int shared;
+    Node* root;
+    Arena* arena;
+} Merge;
 
 static Node* climbAVL(Node *, AVL *);
 static void putAVL(Node *, Node *, AVL *);
@@ -138,14 +282,42 @@ static void fixup(Node *, AVL *);
 static void linearRotate(Node *, AVL *);
 static void nonlinearRotate(Node *, AVL *);
 static char* heavy(Node *);
-static void getStats(AVL *);
-static void printNode(Node *);
+static void printNode(Node *, FILE *);
 static void swapNodes(Node *, Node *);
 static Node* findSuc(Node *);
 static Node* findPred(Node *);
 static void deleteFixup(Node *, AVL *);
 static Node* doSwap(Node *);
 static void trimLeaf(Node *);
+static void noteReads(int, AVL *);
+static void printFrozen(char *, AVL *);
+static void removeKey(Node *, AVL *);
+static int mayHave(char *, AVL *);
+static void missed(AVL *);
+static void lookupBatch(char **, int, Node **, AVL *);
+static void fill(Node *, Bloom *);
+static void markDirty(Node *, AVL *);
+static void markPath(Node *, AVL *);
+static Node* settle(Node *);
+static void collectLive(Node *, Node **, int *, AVL *);
+static void merge(Merge *);
+static void* mergeTask(void *);
+static void split(Node *, char *, Node **, Node **, Node **);
+static Node* join(Node *, Node *, Node *);
+static Node* joinRight(Node *, Node *, Node *);
+static Node* joinLeft(Node *, Node *, Node *);
+static Node* buildRange(Node **, int);
+static void buildTask(Task, int, Steal *);
+static Node* placeNode(Node **, int, Node *);
+static int rangeHeight(int);
+static Node* joinPair(Node *, Node *);
+static Node* splitLast(Node *, Node **);
+static Node* link(Node *, Node *, Node *);
+static Node* turnLeft(Node *);
+static Node* turnRight(Node *);
+static int heightOf(Node *);
+static void dropNode(Node *, Arena *);
+static int dropTree(Node *, AVL *);
 
 AVL* initAVL(void)
 {
@@ -153,39 +325,100 @@ AVL* initAVL(void)
     if (a == 0) { fprintf(stderr,"out of memory"); exit(-1); }
     
     a->size = 0;
-    a->height = 0;
-    a->min = -1;
     a->root = NULL;
+    a->out = stdout;
+    a->frozen = NULL;
+    a->reads = 0;
+    a->filter = NULL;
+    a->hot = initCache();
+    a->lazy = 0;
+    a->tombs = 0;
+    a->relaxed = 0;
+    a->pending = 0;
+    a->rotations = 0;
+    a->arena = NULL;
     return a;
 }
 
 void insertAVL(Node* n, AVL* a)
 {
-    if (!a->root)
+    int size = a->size;
+    Node* t;
+
+    thawAVL(a);
+    //Repeat keys skip the descent
+    if ((t = findCache(n->data, a->hot)))
+    {
+        //A tombstone comes back with nothing to restructure
+        t->freq += n->freq;
+        if (t->freq == n->freq)
+        {
+            a->tombs--;
+            a->size++;
+        }
+    }
+    else if (!a->root)
     {
         a->root = n;
         n->parent = n;
         a->size++;
     }
     else
-        putAVL(n, climbAVL(n, a), a);
+    {
+        t = climbAVL(n, a);
+        putAVL(n, t, a);
+        //Only keys seen twice are cached, so one-off words don't evict hot ones
+        if (a->size == size)
+            fillCache(t, a->hot);
+    }
+
+    if (a->filter && a->size > size)
+    {
+        addBloom(n->data, a->filter);
+        if (fullBloom(a->filter))
+            filterAVL(a);
+    }
+    //A repeat key leaves its node unlinked, so the arena can have it back
+    if (a->arena && !n->parent)
+        releaseNode(n, a->arena);
 }
 
 void deleetAVL(Node* ptr, AVL* b)
 {
     if(isEmptyTreeAVL(b)) {return;}
-    
+    if(!mayHave(ptr->data, b)) { fprintf(b->out, "The string \"%s\" does not exist.\n", ptr->data); return;}
+
+    removeKey(ptr, b);
+}
+
+static void removeKey(Node* ptr, AVL* b)
+{
     Node* n = climbAVL(ptr, b);
-    if(strcmp(n->data, ptr->data) != 0) { printf("The string \"%s\" does not exist.\n", ptr->data); return;}
+    if(compareKey(n->data, ptr->data) != 0 || !n->freq) { missed(b); fprintf(b->out, "The string \"%s\" does not exist.\n", ptr->data); return;}
  
+    thawAVL(b);
     n->freq--;
     
     if(!n->freq)
     {
+        if(b->filter)
+            removeBloom(n->data, b->filter);
+        //The node stays, and stays cached, so a re-insert finds it at once
+        if(b->lazy)
+        {
+            b->size--;
+            b->tombs++;
+            if((long long) b->tombs * 100 >= (long long) b->lazy * (b->size + b->tombs))
+                compactAVL(b);
+            return;
+        }
+        dropCache(n->data, b->hot);
         if(n == b->root && isLeafAVL(b->root))
         {
             b->root = NULL;
             b->size = 0;
+            if(b->arena)
+                releaseNode(n, b->arena);
             return;
         }
         
@@ -194,78 +427,522 @@ void deleetAVL(Node* ptr, AVL* b)
         deleteFixup(s, b);
         trimLeaf(s);
         b->size--;
+        //The key moved off s may still be cached against it, and s may next hold any key
+        if(b->arena)
+        {
+            if(s != n)
+                dropCache(n->data, b->hot);
+            releaseNode(s, b->arena);
+        }
     }
 }
 
 void printTreeAVL(AVL* b)
 {
-    if(isEmptyTreeAVL(b)) {return;}
+    //Tombstones are swept first, so s shows neither a deleted key nor its place
+    compactAVL(b);
+    showTreeAVL(b->out, b);
+}
+
+void showTreeAVL(FILE* out, AVL* b)
+{
+    if(!b->root || !b->size) { fprintf(out, "Empty Tree!\n"); return;}
     
     Queue* q = initQueue();
+    Visit v;
     Node* n;
     int level = -1;
     
-    enqueue(b->root, q);
-    b->root->level = 0;
+    enqueue(b->root, b->root, 0, q);
     
     while(q->size > 0)
     {
-        n = dequeue(q);
-        n->next = NULL;
+        v = dequeue(q);
+        n = v.node;
         
-        if(n->level != level)
+        if(v.depth != level)
         {
             if(level != -1)
-                printf("\n");
-            printf("%d:", ++level);
+                fprintf(out, "\n");
+            fprintf(out, "%d:", ++level);
         }
         
-        printNode(n);
+        if(n->freq)
+            printNode(n, out);
         
         if(n->left)
-        {
-            enqueue(n->left, q);
-            n->left->level = n->level + 1;
-        }
-        
+            enqueue(n->left, n, v.depth + 1, q);
         if(n->right)
-        {
-            enqueue(n->right, q);
-            n->right->level = n->level + 1;
-        }
+            enqueue(n->right, n, v.depth + 1, q);
     }
+    freeQueue(q);
 }
 
 void printStatsAVL(AVL* b)
 {
-    if(isEmptyTreeAVL(b)) {return;}
+    compactAVL(b);
+    showStatsAVL(b->out, b);
+}
+
+void showStatsAVL(FILE* out, AVL* b)
+{
+    if(!b->root || !b->size) { fprintf(out, "Empty Tree!\n"); return;}
+    
+    Stats st;
+
+    statsAVL(b, &st);
+    fprintf(out, "\nNumber of Nodes in AVL: %d\n", b->size);
+    fprintf(out, "Distance to Closest Null Child: %d\n", st.min);
+    fprintf(out, "Distance to Furthest Null Child: %d\n", st.height);
+    fprintf(out, "Average Depth by Frequency: %.2f\n", st.depth);
+}
+
+void statsAVL(AVL* b, Stats* st)
+{
+    Queue* q = initQueue();
+    Visit v;
+    Node* n;
+    long long sum = 0;
+
+    st->min = -1;
+    st->height = 0;
+    st->weight = 0;
+    if(b->root)
+        enqueue(b->root, b->root, 0, q);
     
-    getStats(b);
-    printf("\nNumber of Nodes in AVL: %d\n", b->size);
-    printf("Distance to Closest Null Child: %d\n", b->min);
-    printf("Distance to Furthest Null Child: %d\n", b->height);
+    while(q->size > 0)
+    {
+        v = dequeue(q);
+        n = v.node;
+        sum += (long long) n->freq * v.depth;
+        st->weight += n->freq;
+        if(!n->left || !n->right)
+        {
+            if(st->min == -1)
+                st->min = v.depth;
+            st->height = v.depth;
+        }
+        if(n->left)
+            enqueue(n->left, n, v.depth + 1, q);
+        if(n->right)
+            enqueue(n->right, n, v.depth + 1, q);
+    }
+    st->depth = st->weight ? (double) sum / st->weight : 0;
+    freeQueue(q);
 }
 
 void printFreqAVL(Node* n, AVL* b)
 {
     if(isEmptyTreeAVL(b)) {return;}
+    if(!mayHave(n->data, b)) { fprintf(b->out, "The string \"%s\" does not exist.\n", n->data); return;}
+    noteReads(1, b);
+    if(b->frozen) {printFrozen(n->data, b); return;}
     Node* ptr = climbAVL(n, b);
     
-    if(strcmp(n->data, ptr->data) == 0)
-        printf("\"%s\" has frequency %d\n", ptr->data, ptr->freq);
+    if(compareKey(n->data, ptr->data) == 0 && ptr->freq)
+        fprintf(b->out, "\"%s\" has frequency %d\n", ptr->data, ptr->freq);
     else
     {
-        printf("The string \"%s\" does not exist.\n", n->data);
+        missed(b);
+        fprintf(b->out, "The string \"%s\" does not exist.\n", n->data);
         return;
     }
 }
 
+void showFreqAVL(char* str, FILE* out, AVL* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
+
+    //The frozen index is only built or dropped by writers, so it is safe to share
+    if(b->frozen)
+    {
+        FrozenSlot* s = findFrozen(str, b->frozen);
+        if(s && s->freq)
+            fprintf(out, "\"%s\" has frequency %d\n", frozenKey(s, b->frozen), s->freq);
+        else
+            fprintf(out, "The string \"%s\" does not exist.\n", str);
+        return;
+    }
+
+    Node* ptr = findAVL(str, b);
+    if(ptr)
+        fprintf(out, "\"%s\" has frequency %d\n", ptr->data, ptr->freq);
+    else
+        fprintf(out, "The string \"%s\" does not exist.\n", str);
+}
+
+Node* findAVL(char* str, AVL* b)
+{
+    Node* ptr = b->root;
+
+    while(ptr)
+    {
+        COUNT(visits);
+        int c = compareKey(str, ptr->data);
+        if(c < 0)
+            ptr = ptr->left;
+        else if(c > 0)
+            ptr = ptr->right;
+        else
+            return ptr->freq ? ptr : NULL;
+    }
+    return NULL;
+}
+
+void findBatchAVL(char** keys, int count, Node** found, AVL* b)
+{
+    Node* at[FIND_GROUP];
+    int key[FIND_GROUP];
+    int loaded[FIND_GROUP];
+    int lanes = 0, next = 0, i;
+
+    if(!b->root)
+    {
+        for(i = 0; i < count; i++)
+            found[i] = NULL;
+        return;
+    }
+
+    while(lanes < FIND_GROUP && next < count)
+    {
+        at[lanes] = b->root;
+        loaded[lanes] = 0;
+        key[lanes++] = next++;
+    }
+
+    //Each lane alternates between fetching its node's key and stepping down
+    while(lanes > 0)
+    {
+        for(i = 0; i < lanes; i++)
+        {
+            Node* n = at[i];
+
+            if(!loaded[i])
+            {
+                __builtin_prefetch(n->data);
+                loaded[i] = 1;
+                continue;
+            }
+
+            COUNT(visits);
+            int c = compareKey(keys[key[i]], n->data);
+            Node* child = c < 0 ? n->left : n->right;
+
+            if(c != 0 && child)
+            {
+                __builtin_prefetch(child);
+                at[i] = child;
+                loaded[i] = 0;
+                continue;
+            }
+
+            found[key[i]] = c == 0 ? n : NULL;
+            if(next < count)
+            {
+                at[i] = b->root;
+                loaded[i] = 0;
+                key[i] = next++;
+            }
+            else
+            {
+                lanes--;
+                at[i] = at[lanes];
+                loaded[i] = loaded[lanes];
+                key[i] = key[lanes];
+                i--;
+            }
+        }
+    }
+}
+
+void printFreqBatchAVL(char** keys, int count, AVL* b)
+{
+    Node* found[FIND_GROUP];
+    int i, j, m;
+
+    if(b->root)
+        noteReads(count, b);
+    if(b->frozen)
+    {
+        for(i = 0; i < count; i++)
+        {
+            if(mayHave(keys[i], b))
+                printFrozen(keys[i], b);
+            else
+                fprintf(b->out, "The string \"%s\" does not exist.\n", keys[i]);
+        }
+        return;
+    }
+
+    for(i = 0; i < count; i += FIND_GROUP)
+    {
+        m = count - i < FIND_GROUP ? count - i : FIND_GROUP;
+        lookupBatch(keys + i, m, found, b);
+
+        for(j = 0; j < m; j++)
+        {
+            if(isEmptyTreeAVL(b))
+                continue;
+            if(found[j] && found[j]->freq)
+                fprintf(b->out, "\"%s\" has frequency %d\n", found[j]->data, found[j]->freq);
+            else
+                fprintf(b->out, "The string \"%s\" does not exist.\n", keys[i + j]);
+        }
+    }
+}
+
+void deleetBatchAVL(char** keys, int count, AVL* b)
+{
+    Node* found[FIND_GROUP];
+    Node probe;
+    int i, j, m;
+
+    for(i = 0; i < count; i += FIND_GROUP)
+    {
+        m = count - i < FIND_GROUP ? count - i : FIND_GROUP;
+        lookupBatch(keys + i, m, found, b);
+
+        //Deletes never add keys, so a key missing now stays missing
+        for(j = 0; j < m; j++)
+        {
+            if(isEmptyTreeAVL(b))
+                continue;
+            if(!found[j])
+                fprintf(b->out, "The string \"%s\" does not exist.\n", keys[i + j]);
+            else
+            {
+                //A compaction by an earlier key may have freed a tombstone found here
+                probe.data = keys[i + j];
+                removeKey(&probe, b);
+            }
+        }
+    }
+}
+
+void freezeAVL(AVL* b)
+{
+    thawAVL(b);
+    if(b->root)
+        b->frozen = freezeTree(b->root, b->size + b->tombs);
+}
+
+void filterAVL(AVL* b)
+{
+    Bloom* f = initBloom(2 * b->size);
+
+    fill(b->root, f);
+    if(b->filter)
+    {
+        f->checks = b->filter->checks;
+        f->rejects = b->filter->rejects;
+        f->misses = b->filter->misses;
+        freeBloom(b->filter);
+    }
+    b->filter = f;
+}
+
+void thawAVL(AVL* b)
+{
+    if(b->frozen)
+    {
+        thawFrozen(b->frozen);
+        b->frozen = NULL;
+    }
+    b->reads = 0;
+}
+
+void showRangeAVL(char* lo, char* hi, FILE* out, AVL* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
+
+    if(!listRange(b->root, lo, hi, out))
+        fprintf(out, "No strings from \"%s\" to \"%s\".\n", lo, hi);
+}
+
+void unionAVL(AVL* into, AVL* from, int threads)
+{
+    Merge m;
+
+    //Tombstones would throw off the count of keys the trees share
+    compactAVL(into);
+    compactAVL(from);
+    thawAVL(into);
+    thawAVL(from);
+    m.a = into->root;
+    m.b = from->root;
+    m.spawn = 0;
+    m.shared = 0;
+    m.arena = into->arena;
+    //An arena is not locked, so a tree drawing from one merges on one thread
+    while(!m.arena && (1 << m.spawn) < threads)
+        m.spawn++;
+
+    merge(&m);
+    into->root = m.root;
+    if(into->root)
+        into->root->parent = into->root;
+    into->size += from->size - m.shared;
+    if(into->filter)
+        filterAVL(into);
+
+    //The matched nodes of from are gone, so its cache may point at freed memory
+    from->root = NULL;
+    from->size = 0;
+    free(from->hot);
+    from->hot = initCache();
+}
+
+int deleetRangeAVL(char* lo, char* hi, AVL* b)
+{
+    Node *l, *first, *rest, *mid, *last, *r;
+    int gone;
+
+    if(isEmptyTreeAVL(b)) {return 0;}
+    if(compareKey(lo, hi) > 0) {return 0;}
+
+    compactAVL(b);
+    if(!b->root) {return 0;}
+    thawAVL(b);
+    split(b->root, lo, &l, &first, &rest);
+    split(rest, hi, &mid, &last, &r);
+
+    //The split keys themselves are in the range, but not in mid
+    if(first)
+        first->left = first->right = NULL;
+    if(last)
+        last->left = last->right = NULL;
+    gone = dropTree(mid, b) + dropTree(first, b) + dropTree(last, b);
+
+    b->root = joinPair(l, r);
+    if(b->root)
+        b->root->parent = b->root;
+    b->size -= gone;
+    return gone;
+}
+
+void settleAVL(AVL* b)
+{
+    long before = turns;
+
+    if(!b->pending)
+        return;
+    b->root = settle(b->root);
+    b->root->parent = b->root;
+    b->pending = 0;
+    b->rotations += turns - before;
+}
+
+void compactAVL(AVL* b)
+{
+    Node** nodes;
+    int count = 0;
+
+    if(!b->tombs)
+        return;
+    nodes = malloc((b->size + 1) * sizeof(Node *));
+    if (nodes == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    collectLive(b->root, nodes, &count, b);
+    b->tombs = 0;
+    bulkAVL(nodes, count, 1, b);
+    free(nodes);
+}
+
+void bulkAVL(Node** nodes, int count, int threads, AVL* b)
+{
+    Task all = {NULL, 0, count};
+
+    thawAVL(b);
+    if(threads > 1 && count > 2 * BUILD_GRAIN)
+    {
+        runSteal(threads, buildTask, all, nodes);
+        b->root = nodes[count / 2];
+    }
+    else
+        b->root = buildRange(nodes, count);
+    if(b->root)
+        b->root->parent = b->root;
+    b->size = count;
+    if(b->filter)
+        filterAVL(b);
+}
+
+static void noteReads(int count, AVL* b)
+{
+    if(b->frozen)
+        return;
+    b->reads += count;
+    if(b->reads >= FREEZE_AFTER && b->reads >= b->size / 4)
+        b->frozen = freezeTree(b->root, b->size + b->tombs);
+}
+
+static void printFrozen(char* str, AVL* b)
+{
+    FrozenSlot* s = findFrozen(str, b->frozen);
+
+    if(s && s->freq)
+        fprintf(b->out, "\"%s\" has frequency %d\n", frozenKey(s, b->frozen), s->freq);
+    else
+    {
+        missed(b);
+        fprintf(b->out, "The string \"%s\" does not exist.\n", str);
+    }
+}
+
+static int mayHave(char* str, AVL* b)
+{
+    return !b->filter || checkBloom(str, b->filter);
+}
+
+static void missed(AVL* b)
+{
+    if(b->filter)
+        missBloom(b->filter);
+}
+
+static void lookupBatch(char** keys, int count, Node** found, AVL* b)
+{
+    char* pass[FIND_GROUP];
+    Node* hit[FIND_GROUP];
+    int at[FIND_GROUP];
+    int i, n = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        found[i] = NULL;
+        if(b->root && mayHave(keys[i], b))
+        {
+            pass[n] = keys[i];
+            at[n++] = i;
+        }
+    }
+
+    findBatchAVL(pass, n, hit, b);
+    for(i = 0; i < n; i++)
+    {
+        if(!hit[i])
+            missed(b);
+        found[at[i]] = hit[i];
+    }
+}
+
+static void fill(Node* n, Bloom* f)
+{
+    if(!n) {return;}
+    if(n->freq)
+        addBloom(n->data, f);
+    fill(n->left, f);
+    fill(n->right, f);
+}
+
 static void deleteFixup(Node* n, AVL* a)
 {
     Node* p;
-    n->height = 0;
+    //n is about to be trimmed, leaving at most one leaf child in its place
+    n->height = n->left ? n->left->height : n->right ? n->right->height : 0;
     while(n != a->root)
     {
+        COUNT(deleteFixups);
         p = n->parent;
         
         if(p->fav == n)
@@ -287,22 +964,29 @@ static void deleteFixup(Node* n, AVL* a)
             
             if(f && !isLinear(s))
             {
+                COUNT(deleteNonlinear);
                 nonlinearRotate(s, a);
                 setBalance(p);
                 setBalance(s);
                 setBalance(f);
+                //The root's parent is itself, so it has no favorite to move
+                if(f->parent != f && f->parent->fav == p)
+                    f->parent->fav = f;
                 n = f;
             }
             
             else
             {
+                COUNT(deleteLinear);
                 linearRotate(s, a);
                 setBalance(p);
                 setBalance(s);
+                if(s->parent != s && s->parent->fav == p)
+                    s->parent->fav = s;
                 if(!f)
                     return;
                 else
-                    n = f;
+                    n = s;
             }
         }
     }
@@ -329,13 +1013,10 @@ static Node* doSwap(Node* n)
 
 static void swapNodes(Node* n, Node* q)
 {
-    char* t_data = n->data;
     int t_freq = n->freq;
     
-    n->data = q->data;
+    swapKeys(n, q);
     n->freq = q->freq;
-    
-    q->data = t_data;
     q->freq = t_freq;
 }
 
@@ -345,9 +1026,10 @@ static Node* climbAVL(Node* n, AVL* b)
     
     while(ptr)
     {
-        if(strcmp(n->data, ptr->data) < 0 && ptr->left)
+        COUNT(visits);
+        if(compareKey(n->data, ptr->data) < 0 && ptr->left)
             ptr = ptr->left;
-        else if(strcmp(n->data, ptr->data) > 0 && ptr->right)
+        else if(compareKey(n->data, ptr->data) > 0 && ptr->right)
             ptr = ptr->right;
         else
             break;
@@ -357,21 +1039,30 @@ static Node* climbAVL(Node* n, AVL* b)
 
 static void putAVL(Node* n, Node* t, AVL* b)
 {   //If Equal, Update Freq and Return
-    if(strcmp(n->data, t->data) == 0)
+    if(compareKey(n->data, t->data) == 0)
     {
-        t->freq++;
+        //A tombstone counts as a key again
+        t->freq += n->freq;
+        if(t->freq == n->freq)
+        {
+            b->tombs--;
+            b->size++;
+        }
         return;
     }
     //Add Left
-    if(strcmp(n->data, t->data) < 0)
+    if(compareKey(n->data, t->data) < 0)
         t->left = n;
     //Add Right
-    else if(strcmp(n->data, t->data) > 0)
+    else if(compareKey(n->data, t->data) > 0)
         t->right = n;
     
     n->parent = t;
     b->size++;
-    fixup(n, b);
+    if(b->relaxed)
+        markDirty(n, b);
+    else
+        fixup(n, b);
 }
 
 static void fixup(Node* n, AVL* a)
@@ -379,6 +1070,7 @@ static void fixup(Node* n, AVL* a)
     Node* p;
     while(n != a->root)
     {
+        COUNT(insertFixups);
         p = n->parent;
         
         if(sibling(n) && p->fav == sibling(n))
@@ -397,6 +1089,8 @@ static void fixup(Node* n, AVL* a)
             
             if(f && !isLinear(n))
             {
+                a->rotations += 2;
+                COUNT(insertNonlinear);
                 nonlinearRotate(n, a);
                 setBalance(n);
                 setBalance(p);
@@ -405,6 +1099,8 @@ static void fixup(Node* n, AVL* a)
             }
             else
             {
+                a->rotations++;
+                COUNT(insertLinear);
                 linearRotate(n, a);
                 setBalance(p);
                 setBalance(n);
@@ -450,7 +1146,6 @@ static void nonlinearRotate(Node* n, AVL* a)
 
 static void linearRotate(Node* n, AVL* a)
 {
-    int type = isLinear(n);
     Node* p = n->parent;
     int pflag = 0;
     
@@ -463,7 +1158,7 @@ static void linearRotate(Node* n, AVL* a)
         a->root = temp;
     }
     
-    if(type == 1)
+    if(p->right == n)
         rotateLeft(n);
     else
         rotateRight(n);
@@ -481,7 +1176,7 @@ static char leftOrRightAVL(Node* n)
     Node* p = n->parent;
     if (n == p)
         return 'X';
-    else if (p->left && strcmp(p->left->data, n->data) == 0)
+    else if (p->left == n)
         return 'L';
     else
         return 'R';
@@ -595,36 +1290,6 @@ static void rotateLeft(Node* n)
     p->parent = n;
 }
 
-static void getStats(AVL* b)
-{
-    isEmptyTreeAVL(b);
-    
-    Queue* q = initQueue();
-    Queue* lq = initQueue();
-    Node* n;
-    enqueue(b->root, q);
-    b->root->level = 0;
-    
-    while(q->size > 0)
-    {
-        n = dequeue(q);
-        if(!n->left || !n->right)
-            enqueue(n, lq);
-        if(n->left)
-        {
-            enqueue(n->left, q);
-            n->left->level = n->level + 1;
-        }
-        if(n->right)
-        {
-            enqueue(n->right, q);
-            n->right->level = n->level + 1;
-        }
-    }
-    b->min = lq->head->level;
-    b->height = lq->tail->level;
-}
-
 static char* heavy(Node* n)
 {
     if(!n->fav) return NULL;
@@ -675,28 +1340,395 @@ static void trimLeaf(Node* n)
     setBalance(p);
 }
 
-static void printNode(Node* n)
+static void printNode(Node* n, FILE* out)
 {
-    printf(" ");
+    fprintf(out, " ");
     if(isLeafAVL(n))
-        printf("=");
-    printf("%s", n->data);
+        fprintf(out, "=");
+    fprintf(out, "%s", n->data);
     if(heavy(n))
-        printf("%s", heavy(n));
-    printf("(%s", n->parent->data);
+        fprintf(out, "%s", heavy(n));
+    fprintf(out, "(%s", n->parent->data);
     if(heavy(n->parent))
-        printf("%s", heavy(n->parent));
-    printf(")%d", n->freq);
-    printf("%c", leftOrRightAVL(n));
+        fprintf(out, "%s", heavy(n->parent));
+    fprintf(out, ")%d", n->freq);
+    fprintf(out, "%c", leftOrRightAVL(n));
 }
 
 static int isEmptyTreeAVL(AVL* b)
 {
     if(!b->root)
     {
-        printf("Empty Tree!\n");
+        fprintf(b->out, "Empty Tree!\n");
         return 1;
     }
     else
         return 0;
 }
+
+static void markDirty(Node* n, AVL* b)
+{
+    Node* p;
+    int h;
+
+    //Heights climb from the stored side heights as in fixup, so no sibling is read
+    while(n != b->root)
+    {
+        p = n->parent;
+        if(p->left == n)
+            p->lheight = n->height;
+        else
+            p->rheight = n->height;
+        //A marked node is rebuilt by settle from the side height just stored
+        if(!p->height)
+            break;
+        if(p->lheight > p->rheight + 1 || p->rheight > p->lheight + 1)
+        {
+            markPath(p, b);
+            break;
+        }
+        if(p->lheight == p->rheight)
+            p->fav = NULL;
+        else
+            p->fav = p->lheight > p->rheight ? p->left : p->right;
+        h = max(p->lheight, p->rheight) + 1;
+        if(h == p->height)
+            break;
+        p->height = h;
+        n = p;
+    }
+
+    if(++b->pending >= RELAX_BATCH)
+        settleAVL(b);
+}
+
+static void markPath(Node* n, AVL* b)
+{
+    Node* p;
+
+    //Marks run unbroken up from the root, so the first one found ends the walk
+    for(; n->height; n = p)
+    {
+        n->height = 0;
+        if(n == b->root)
+            break;
+        //A marked child shows as side height 0, so settle finds it without reading it
+        p = n->parent;
+        if(p->left == n)
+            p->lheight = 0;
+        else
+            p->rheight = 0;
+    }
+}
+
+static Node* settle(Node* n)
+{
+    Node* c;
+
+    if(!n || n->height)
+        return n;
+
+    //An unmarked child is unchanged, so its stored height stands and it is not read
+    if(n->left && !n->lheight)
+    {
+        c = settle(n->left);
+        c->parent = n;
+        n->left = c;
+        n->lheight = c->height;
+    }
+    if(n->right && !n->rheight)
+    {
+        c = settle(n->right);
+        c->parent = n;
+        n->right = c;
+        n->rheight = c->height;
+    }
+
+    if(n->lheight > n->rheight + 1 || n->rheight > n->lheight + 1)
+        return join(n->left, n, n->right);
+    n->height = max(n->lheight, n->rheight) + 1;
+    if(n->lheight == n->rheight)
+        n->fav = NULL;
+    else
+        n->fav = n->lheight > n->rheight ? n->left : n->right;
+    return n;
+}
+
+static void collectLive(Node* n, Node** nodes, int* count, AVL* b)
+{
+    if(!n)
+        return;
+
+    collectLive(n->left, nodes, count, b);
+    Node* right = n->right;
+    if(n->freq)
+        nodes[(*count)++] = n;
+    else
+    {
+        dropCache(n->data, b->hot);
+        dropNode(n, b->arena);
+    }
+    collectLive(right, nodes, count, b);
+}
+
+static void merge(Merge* m)
+{
+    Node* a = m->a;
+    Node *l, *same, *r;
+    pthread_t t;
+
+    if(!a || !m->b)
+    {
+        m->root = a ? a : m->b;
+        return;
+    }
+
+    split(m->b, a->data, &l, &same, &r);
+    if(same)
+    {
+        a->freq += same->freq;
+        dropNode(same, m->arena);
+        m->shared++;
+    }
+
+    Merge left = {a->left, l, m->spawn - 1, 0, NULL, m->arena};
+    Merge right = {a->right, r, m->spawn - 1, 0, NULL, m->arena};
+
+    //Halves share no nodes, so the left one can run on its own thread
+    if(m->spawn > 0 && pthread_create(&t, NULL, mergeTask, &left) == 0)
+    {
+        merge(&right);
+        pthread_join(t, NULL);
+    }
+    else
+    {
+        merge(&left);
+        merge(&right);
+    }
+
+    m->shared += left.shared + right.shared;
+    m->root = join(left.root, a, right.root);
+}
+
+static void* mergeTask(void* arg)
+{
+    merge(arg);
+    return NULL;
+}
+
+static void split(Node* t, char* str, Node** l, Node** same, Node** r)
+{
+    Node* part;
+
+    if(!t)
+    {
+        *l = *same = *r = NULL;
+        return;
+    }
+
+    int c = compareKey(str, t->data);
+    if(c == 0)
+    {
+        *l = t->left;
+        *same = t;
+        *r = t->right;
+    }
+    else if(c < 0)
+    {
+        split(t->left, str, l, same, &part);
+        *r = join(part, t, t->right);
+    }
+    else
+    {
+        split(t->right, str, &part, same, r);
+        *l = join(t->left, t, part);
+    }
+}
+
+static Node* join(Node* l, Node* k, Node* r)
+{
+    if(heightOf(l) > heightOf(r) + 1)
+        return joinRight(l, k, r);
+    if(heightOf(r) > heightOf(l) + 1)
+        return joinLeft(l, k, r);
+    return link(l, k, r);
+}
+
+static Node* joinRight(Node* l, Node* k, Node* r)
+{
+    Node* c = l->right;
+    Node* t;
+
+    if(heightOf(c) <= heightOf(r) + 1)
+    {
+        t = link(c, k, r);
+        if(heightOf(t) <= heightOf(l->left) + 1)
+            return link(l->left, l, t);
+        return turnLeft(link(l->left, l, turnRight(t)));
+    }
+
+    t = link(l->left, l, joinRight(c, k, r));
+    if(heightOf(t->right) <= heightOf(t->left) + 1)
+        return t;
+    return turnLeft(t);
+}
+
+static Node* joinLeft(Node* l, Node* k, Node* r)
+{
+    Node* c = r->left;
+    Node* t;
+
+    if(heightOf(c) <= heightOf(l) + 1)
+    {
+        t = link(l, k, c);
+        if(heightOf(t) <= heightOf(r->right) + 1)
+            return link(t, r, r->right);
+        return turnRight(link(turnLeft(t), r, r->right));
+    }
+
+    t = link(joinLeft(l, k, c), r, r->right);
+    if(heightOf(t->left) <= heightOf(t->right) + 1)
+        return t;
+    return turnRight(t);
+}
+
+static Node* buildRange(Node** nodes, int count)
+{
+    int mid = count / 2;
+
+    if(count == 0)
+        return NULL;
+    return link(buildRange(nodes, mid), nodes[mid], buildRange(nodes + mid + 1, count - mid - 1));
+}
+
+static void buildTask(Task t, int self, Steal* s)
+{
+    Node** nodes = s->arg;
+    Node* parent = t.item;
+    Node* n;
+    long half;
+
+    while(t.count > BUILD_GRAIN)
+    {
+        half = t.count / 2;
+        n = placeNode(nodes + t.lo, t.count, parent);
+        Task left = {n, t.lo, half};
+        spawn(s, self, left);
+        parent = n;
+        t.lo += half + 1;
+        t.count -= half + 1;
+    }
+    n = buildRange(nodes + t.lo, t.count);
+    if(n)
+        n->parent = parent;
+}
+
+static Node* placeNode(Node** nodes, int count, Node* parent)
+{
+    int mid = count / 2;
+    int right = count - mid - 1;
+    Node* n = nodes[mid];
+
+    //buildRange roots each range at its middle node, so the children are known
+    n->parent = parent;
+    n->left = mid ? nodes[mid / 2] : NULL;
+    n->right = right ? nodes[mid + 1 + right / 2] : NULL;
+    n->lheight = rangeHeight(mid);
+    n->rheight = rangeHeight(right);
+    n->height = max(n->lheight, n->rheight) + 1;
+    if(n->lheight == n->rheight)
+        n->fav = NULL;
+    else
+        n->fav = n->lheight > n->rheight ? n->left : n->right;
+    return n;
+}
+
+static int rangeHeight(int count)
+{
+    int height = 0;
+
+    //The left half is never the smaller, so it sets the height
+    for(; count > 0; count /= 2)
+        height++;
+    return height;
+}
+
+static Node* joinPair(Node* l, Node* r)
+{
+    Node* k;
+
+    if(!l)
+        return r;
+    l = splitLast(l, &k);
+    return join(l, k, r);
+}
+
+static Node* splitLast(Node* t, Node** last)
+{
+    if(!t->right)
+    {
+        *last = t;
+        return t->left;
+    }
+    return join(t->left, t, splitLast(t->right, last));
+}
+
+static Node* link(Node* l, Node* k, Node* r)
+{
+    k->left = l;
+    k->right = r;
+    if(l)
+        l->parent = k;
+    if(r)
+        r->parent = k;
+    setBalance(k);
+    return k;
+}
+
+static Node* turnLeft(Node* x)
+{
+    __atomic_fetch_add(&turns, 1, __ATOMIC_RELAXED);
+    COUNT(joinRotations);
+    Node* y = x->right;
+    Node* in = link(x->left, x, y->left);
+    return link(in, y, y->right);
+}
+
+static Node* turnRight(Node* x)
+{
+    __atomic_fetch_add(&turns, 1, __ATOMIC_RELAXED);
+    COUNT(joinRotations);
+    Node* y = x->left;
+    Node* in = link(y->right, x, x->right);
+    return link(y->left, y, in);
+}
+
+static int heightOf(Node* n)
+{
+    return n ? n->height : 0;
+}
+
+static void dropNode(Node* n, Arena* pool)
+{
+    if(pool)
+    {
+        releaseNode(n, pool);
+        return;
+    }
+    if(n->data != n->key)
+        free(n->data);
+    free(n);
+}
+
+static int dropTree(Node* n, AVL* b)
+{
+    if(!n)
+        return 0;
+
+    int gone = dropTree(n->left, b) + dropTree(n->right, b) + 1;
+    if(b->filter)
+        removeBloom(n->data, b->filter);
+    dropCache(n->data, b->hot);
+    dropNode(n, b->arena);
+    return gone;
+}
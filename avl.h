@@ -13,6 +13,7 @@
  *    intiAVL(void);
  *      - constructor for a new AVL tree
  *      - returns a malloc'd tree object
+ *      - nodes the tree drops are freed, or given back to its arena once one is set
  *      - usage example: AVL* a = initiAVL();
  *
  *    printFreqAVL(Node *, AVL );
@@ -21,20 +22,120 @@
  *
  *    insertAVL(Node *, AVL *);
  *      - inserts a new node into AVL tree
+ *      - a key already in the tree gains the node's frequency, 1 from createNode
+ *      - a key already inserted twice is usually found in the hot key cache without a descent
  *      - usage example: insertAVL(node, tree);
  *
  *    printTreeAVL(AVL *)
  *      - show tree function that prints each node in the tree in specified formnat
+ *      - compacts a lazy tree first, as printStatsAVL does, so no tombstone is shown
  *      - usage example: printTreeAVL(tree);
  *
  *    printStats(AVL *);
- *      - prints distances to shortest null child, furthest null child, and total nodes in tree
+ *      - prints distances to shortest null child, furthest null child, total nodes in tree,
+ *      - and the average depth of a key weighted by its frequency
  *      - usage example: printStatsAVL(tree);
  *
  *    deleetAVL(Node *, AVL *);
  *      - deletes a node from an AVL tree
  *      - usage example: deleetAVL(node, tree);
  *
+ *    findAVL(char *, AVL *);
+ *      - looks up a key
+ *      - returns the node holding the key, else NULL
+ *      - usage example: Node* n = findAVL(str, tree);
+ *
+ *    findBatchAVL(char **, int, Node **, AVL *);
+ *      - looks up many keys at once, advancing FIND_GROUP descents in lockstep
+ *      - and prefetching each next node and key so their cache misses overlap
+ *      - stores the node holding each key, else NULL, in the result array
+ *      - usage example: findBatchAVL(keys, count, found, tree);
+ *
+ *    printFreqBatchAVL(char **, int, AVL *);
+ *      - prints the frequencies of many keys, same output as printFreqAVL on each
+ *      - usage example: printFreqBatchAVL(keys, count, tree);
+ *
+ *    deleetBatchAVL(char **, int, AVL *);
+ *      - deletes many keys in order, same output as deleetAVL on each
+ *      - missing keys are found in one batched pass and never descend again
+ *      - usage example: deleetBatchAVL(keys, count, tree);
+ *
+ *    freezeAVL(AVL *);
+ *      - builds a frozen Eytzinger index of the tree that answers lookups until the next change
+ *      - happens on its own once FREEZE_AFTER lookups, and a quarter of the tree size, run without a change
+ *      - usage example: freezeAVL(tree);
+ *
+ *    thawAVL(AVL *);
+ *      - drops the frozen index, if any, so lookups go back to the nodes
+ *      - insertAVL and deleetAVL call it before changing the tree
+ *      - usage example: thawAVL(tree);
+ *
+ *    showFreqAVL(char *, FILE *, AVL *);
+ *    showTreeAVL(FILE *, AVL *);
+ *    showStatsAVL(FILE *, AVL *);
+ *      - f, s and r written to out without touching the tree: no read counting,
+ *      - freezing or filter statistics, so any number of threads may run them
+ *      - at once as long as no thread is changing the tree.  A lazy tree is shown
+ *      - as it stands, skipping tombstones, since compacting it would change it
+ *      - usage example: showFreqAVL(str, out, tree);
+ *
+ *    showRangeAVL(char *, char *, FILE *, AVL *);
+ *      - writes every key from lo to hi, inclusive, with its frequency, in key order,
+ *      - visiting only the subtrees that can hold keys in the range
+ *      - usage example: showRangeAVL("ba", "bz", out, tree);
+ *
+ *    statsAVL(AVL *, Stats *);
+ *      - walks the tree for the numbers r reports, plus the total frequency they are
+ *      - weighted by, without writing to the tree; min is -1 for an empty tree
+ *      - usage example: statsAVL(tree, &stats);
+ *
+ *    filterAVL(AVL *);
+ *      - puts a counting Bloom filter in front of the tree, or regrows the one there,
+ *      - sized for twice the current keys; insert and delete keep it current and
+ *      - f and d answer keys it rules out without descending
+ *      - usage example: filterAVL(tree);
+ *
+ *    unionAVL(AVL *, AVL *, int);
+ *      - folds every key of the second tree into the first, adding frequencies of
+ *      - keys in both, by splitting and joining subtrees rather than inserting one
+ *      - at a time: O(m log(n/m + 1)) for trees of m <= n keys, with the two halves
+ *      - of each step run in parallel on up to the given number of threads
+ *      - the second tree is left empty
+ *      - usage example: unionAVL(tree, batch, 4);
+ *
+ *    deleetRangeAVL(char *, char *, AVL *);
+ *      - removes every key from lo to hi, inclusive, whatever its frequency, by
+ *      - splitting the range out and joining what is left in O(log n), then
+ *      - freeing the detached nodes
+ *      - returns the number of keys removed
+ *      - usage example: int gone = deleetRangeAVL("ba", "bz", tree);
+ *
+ *    compactAVL(AVL *);
+ *      - with lazy set, deletes leave a key whose frequency reaches zero in place as a
+ *      - tombstone, hidden from f, s, r and l, that an insert brings back without
+ *      - restructuring; once tombstones reach lazy percent of the nodes the tree is
+ *      - rebuilt without them.  compactAVL does that rebuild now
+ *      - size counts only live keys, tombs the tombstones
+ *      - usage example: tree->lazy = 25; ... compactAVL(tree);
+ *
+ *    settleAVL(AVL *);
+ *      - with relaxed set, an insert climbs the heights above its node as usual,
+ *      - but a node that falls out of balance is marked, with its ancestors,
+ *      - instead of rotated; every RELAX_BATCH inserts, or when settleAVL is
+ *      - called, each marked node is joined with its settled subtrees, bottom
+ *      - up, so paths shared by many inserts are rebalanced once.  Only
+ *      - insertAVL may run while inserts are pending, so call settleAVL
+ *      - before anything else reads the tree
+ *      - rotations counts the rotations either way
+ *      - usage example: tree->relaxed = 1; ... settleAVL(tree); tree->relaxed = 0;
+ *
+ *    bulkAVL(Node **, int, int, AVL *);
+ *      - builds an empty tree from nodes already in strictly increasing key order,
+ *      - each middle node becoming the root of its range, in O(n) with no compares
+ *      - with more than one thread, ranges of more than BUILD_GRAIN nodes are split
+ *      - over a work-stealing scheduler; the tree is the same either way
+ *      - usage example: bulkAVL(nodes, count, 4, tree);
+ *
  */
 
 #ifndef AVL_h
@@ -44,14 +145,43 @@
 
 #include "node.h"
 #include "queue.h"
+#include "frozen.h"
+#include "bloom.h"
+#include "cache.h"
+#include "arena.h"
+
+#define FIND_GROUP 16
+#define FREEZE_AFTER 4096
+#define RELAX_BATCH 8
+#define BUILD_GRAIN (1 << 14)
 
+typedef struct Stats
+{
+    int min;
+    int height;
+    double depth;
+    long long weight;
+} Stats;
 
 typedef struct AVL
 {
     Node* root;
-    int height;
-    int min;
     int size;
+    FILE* out;
+
+    Frozen* frozen;
+    int reads;
+    Bloom* filter;
+    Cache* hot;
+
+    int lazy;
+    int tombs;
+
+    int relaxed;
+    int pending;
+    long rotations;
+
+    Arena* arena;
 } AVL;
 
 extern AVL* initAVL(void);
@@ -60,4 +190,21 @@ extern void insertAVL(Node *, AVL *);
 extern void printTreeAVL(AVL *);
 extern void printStatsAVL(AVL *);
 extern void deleetAVL(Node *, AVL *);
+extern Node* findAVL(char *, AVL *);
+extern void showFreqAVL(char *, FILE *, AVL *);
+extern void showTreeAVL(FILE *, AVL *);
+extern void showStatsAVL(FILE *, AVL *);
+extern void showRangeAVL(char *, char *, FILE *, AVL *);
+extern void statsAVL(AVL *, Stats *);
+extern void findBatchAVL(char **, int, Node **, AVL *);
+extern void printFreqBatchAVL(char **, int, AVL *);
+extern void deleetBatchAVL(char **, int, AVL *);
+extern void freezeAVL(AVL *);
+extern void thawAVL(AVL *);
+extern void filterAVL(AVL *);
+extern void unionAVL(AVL *, AVL *, int);
+extern int deleetRangeAVL(char *, char *, AVL *);
+extern void bulkAVL(Node **, int, int, AVL *);
+extern void compactAVL(AVL *);
+extern void settleAVL(AVL *);
 #endif /* AVL_h */
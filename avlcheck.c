@@ -0,0 +1,195 @@
+//  Random workload check for the AVL tree
+//
+//  avlcheck [SEEDS] [STEPS]
+//
+//  For each seed from 1 to SEEDS (default 50), runs STEPS random inserts,
+//  deletes and range deletes (default 2000) over a small key space, so
+//  keys come and go often and every rotation case is reached.  Each seed
+//  also builds a tree of STEPS keys in relaxed mode, checking it each time
+//  it is settled.  After every
+//  operation the whole tree is checked: each node's heights match its
+//  children, no node is out of balance, each favorite is the taller child,
+//  parent links point back, keys are in order, the root is its own parent
+//  and the size matches the nodes.  The first broken invariant is printed
+//  with its seed and step, and the exit status is 1.  Key spaces of 8 and
+//  64 keys are both run.
+//
+//  Sample Call
+//  -----------
+//
+//  avlcheck 200 5000
+//
+/* VERSION 1.0
+ *
+ * avlcheck.c - random workload invariant check for the AVL tree
+ *            - written by Ben Lindow
+ *
+ *    runSeed(unsigned, int, int);
+ *      - runs one random workload over a key space, checking the tree after every step
+ *      - returns 1 if every check held, else 0
+ *      - usage example: ok &= runSeed(seed, steps, 8);
+ *
+ *    relaxSeed(unsigned, int);
+ *      - builds a tree in relaxed mode, settling and checking it at random points
+ *      - returns 1 if every check held, else 0
+ *      - usage example: ok &= relaxSeed(seed, steps);
+ *
+ *    checkTree(AVL *);
+ *      - checks every invariant of a tree
+ *      - returns NULL if all hold, else a description of the first one broken
+ *      - usage example: char* why = checkTree(a);
+ *
+ *    checkNode(Node *, Node *, char *, char *, int *, char **);
+ *      - checks the subtree under a node against its parent and key bounds
+ *      - returns the subtree's height, counting its nodes and noting the first broken invariant
+ *      - usage example: checkNode(a->root, a->root, NULL, NULL, &count, &why);
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avl.h"
+
+static int runSeed(unsigned, int, int);
+static int relaxSeed(unsigned, int);
+static char* checkTree(AVL *);
+static int checkNode(Node *, Node *, char *, char *, int *, char **);
+
+int main(int argc, char** argv)
+{
+    int seeds = argc > 1 ? atoi(argv[1]) : 50;
+    int steps = argc > 2 ? atoi(argv[2]) : 2000;
+    int ok = 1, s;
+
+    for (s = 1; s <= seeds; s++)
+    {
+        ok &= runSeed(s, steps, 8);
+        ok &= runSeed(s, steps, 64);
+        ok &= relaxSeed(s, steps);
+    }
+    if (ok)
+        printf("avlcheck: %d seeds of %d steps, every invariant held\n", seeds, steps);
+    return !ok;
+}
+
+static int runSeed(unsigned seed, int steps, int keys)
+{
+    AVL* a = initAVL();
+    char key[16], hi[16];
+    char* why;
+    int i, op;
+
+    a->out = fopen("/dev/null", "w");
+    srand(seed);
+    for (i = 1; i <= steps; i++)
+    {
+        op = rand() % 10;
+        sprintf(key, "k%02d", rand() % keys);
+        if (op < 5)
+        {
+            Node* n = createNode(key);
+            insertAVL(n, a);
+            //A repeat key leaves its node unlinked
+            if (!n->parent)
+                free(n);
+        }
+        else if (op < 9)
+        {
+            Node* n = createNode(key);
+            deleetAVL(n, a);
+            free(n);
+        }
+        else
+        {
+            sprintf(hi, "k%02d", rand() % keys);
+            deleetRangeAVL(key, hi, a);
+        }
+
+        if ((why = checkTree(a)))
+        {
+            printf("avlcheck: seed %u, %d keys, step %d: %s\n", seed, keys, i, why);
+            fclose(a->out);
+            return 0;
+        }
+    }
+    fclose(a->out);
+    return 1;
+}
+
+static int relaxSeed(unsigned seed, int steps)
+{
+    AVL* a = initAVL();
+    char key[16];
+    char* why;
+    int i;
+
+    a->out = fopen("/dev/null", "w");
+    a->relaxed = 1;
+    srand(seed);
+    for (i = 1; i <= steps; i++)
+    {
+        //Every third seed inserts in order, the worst case for eager inserts
+        if (seed % 3 == 0)
+            sprintf(key, "k%06d", i);
+        else
+            sprintf(key, "k%06d", rand() % (4 * steps));
+        Node* n = createNode(key);
+        insertAVL(n, a);
+        if (!n->parent)
+            free(n);
+
+        if (i == steps || rand() % 50 == 0)
+        {
+            settleAVL(a);
+            if ((why = checkTree(a)))
+            {
+                printf("avlcheck: seed %u, relaxed, step %d: %s\n", seed, i, why);
+                fclose(a->out);
+                return 0;
+            }
+        }
+    }
+    fclose(a->out);
+    return 1;
+}
+
+static char* checkTree(AVL* a)
+{
+    char* why = NULL;
+    int count = 0;
+
+    if (!a->root)
+        return a->size ? "empty tree with a nonzero size" : NULL;
+    if (a->root->parent != a->root)
+        return "root is not its own parent";
+    checkNode(a->root, a->root, NULL, NULL, &count, &why);
+    if (!why && count != a->size)
+        why = "size does not match the node count";
+    return why;
+}
+
+static int checkNode(Node* n, Node* parent, char* lo, char* hi, int* count, char** why)
+{
+    int lh, rh;
+
+    if (!n)
+        return 0;
+    (*count)++;
+    lh = checkNode(n->left, n, lo, n->data, count, why);
+    rh = checkNode(n->right, n, n->data, hi, count, why);
+    if (*why)
+        return 0;
+
+    if (n->parent != parent)
+        *why = "child's parent link is wrong";
+    else if ((lo && strcmp(lo, n->data) >= 0) || (hi && strcmp(n->data, hi) >= 0))
+        *why = "keys out of order";
+    else if (n->lheight != lh || n->rheight != rh || n->height != (lh > rh ? lh : rh) + 1)
+        *why = "stored heights are wrong";
+    else if (lh - rh > 1 || rh - lh > 1)
+        *why = "node out of balance";
+    else if (n->fav != (lh > rh ? n->left : rh > lh ? n->right : NULL))
+        *why = "favorite is not the taller child";
+    return n->height;
+}
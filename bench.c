@@ -0,0 +1,459 @@
+//  Micro benchmarks for the tree engines
+//
+//  bench lookup [NODES] [LOOKUPS]
+//  bench filter [NODES] [LOOKUPS]
+//  bench streams [NODES] [LOOKUPS]
+//  bench relax [NODES]
+//  bench bulk [NODES]
+//
+//  lookup builds an AVL tree of NODES random keys (default 4000000, far
+//  past the last level cache once the keys and nodes are counted) and
+//  times LOOKUPS random lookups (default 2000000, half hits, half misses)
+//  done one at a time with findAVL, in groups with findBatchAVL, and
+//  against a frozen Eytzinger index of the same tree.
+//
+//  filter builds the same tree and times the same lookups with and
+//  without a counting Bloom filter in front, then reports how many absent
+//  keys the filter let through.
+//
+//  streams builds the same tree and splits the lookups over 1, 2, 4 and
+//  8 reader threads sharing it through the reader-writer lock, while one
+//  writer thread inserts and deletes batches of new keys, and reports
+//  lookups per second against thread count.
+//
+//  relax inserts NODES random keys (default 1000000) into an AVL tree
+//  rebalanced after every insert and into one in relaxed mode, once in
+//  random order and once in sorted order, and reports the time per insert,
+//  the rotations made and the height of the settled tree.
+//
+//  bulk sorts NODES random keys (default 4000000) and bulk builds a
+//  balanced AVL tree from them with 1, 2, 4 and 8 threads, reporting the
+//  time and speedup of each over one thread and checking that every build
+//  made the same tree.
+//
+//  Sample Call
+//  -----------
+//
+//  bench lookup 8000000 4000000
+//
+/* VERSION 1.0
+ *
+ * bench.c   - benchmark driver for the tree engines
+ *           - written by Ben Lindow
+ *
+ *    benchLookup(long, long);
+ *      - times single, batched and frozen AVL lookups
+ *      - usage example: benchLookup(nodes, lookups);
+ *
+ *    benchFilter(long, long);
+ *      - times AVL lookups with and without a Bloom filter in front
+ *      - usage example: benchFilter(nodes, lookups);
+ *
+ *    benchStreams(long, long);
+ *      - times lookups from a growing number of reader threads beside one writer
+ *      - usage example: benchStreams(nodes, lookups);
+ *
+ *    benchRelax(long);
+ *      - times eager against relaxed AVL inserts, in random and sorted order
+ *      - usage example: benchRelax(nodes);
+ *
+ *    relaxRun(char **, long, int, char *);
+ *      - inserts keys into a new AVL tree, relaxed or not, and prints the result
+ *      - usage example: relaxRun(words, nodes, 1, "random");
+ *
+ *    compareKeys(const void *, const void *);
+ *      - qsort comparator, by key
+ *      - usage example: qsort(words, nodes, sizeof(char *), compareKeys);
+ *
+ *    benchBulk(long);
+ *      - times bulk builds of one sorted array over a growing number of threads
+ *      - usage example: benchBulk(nodes);
+ *
+ *    readWorker(void *), writeWorker(void *);
+ *      - reader and writer thread bodies for benchStreams
+ *      - usage example: pthread_create(&t, NULL, readWorker, &workers[i]);
+ *
+ *    buildRandom(long, char **, long);
+ *      - builds an AVL tree of random keys and a shuffled set of lookup keys, half of them resident
+ *      - returns the tree
+ *      - usage example: AVL* a = buildRandom(nodes, keys, lookups);
+ *
+ *    randomKey(void);
+ *      - makes a random lowercase key of 8 to 15 letters
+ *      - returns a malloc'd string
+ *      - usage example: char* k = randomKey();
+ *
+ *    now(void);
+ *      - monotonic clock in seconds
+ *      - returns the current time
+ *      - usage example: double t = now();
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "scanner.h"
+#include "node.h"
+#include "avl.h"
+#include "shared.h"
+
+typedef struct Worker
+{
+    pthread_t thread;
+    AVL* a;
+    Shared* lock;
+    char** keys;
+    long count;
+    long done;
+} Worker;
+
+int stopWriter;
+
+void benchLookup(long, long);
+void benchFilter(long, long);
+void benchStreams(long, long);
+void benchRelax(long);
+void benchBulk(long);
+void relaxRun(char **, long, int, char *);
+int compareKeys(const void *, const void *);
+void* readWorker(void *);
+void* writeWorker(void *);
+AVL* buildRandom(long, char **, long);
+char* randomKey(void);
+double now(void);
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr,"usage: bench lookup|filter|streams|relax|bulk [NODES] [LOOKUPS]\n");
+        exit(1);
+    }
+
+    srand(201);
+    if (strcmp(argv[1], "lookup") == 0)
+        benchLookup(argc > 2 ? atol(argv[2]) : 4000000, argc > 3 ? atol(argv[3]) : 2000000);
+    else if (strcmp(argv[1], "filter") == 0)
+        benchFilter(argc > 2 ? atol(argv[2]) : 4000000, argc > 3 ? atol(argv[3]) : 2000000);
+    else if (strcmp(argv[1], "streams") == 0)
+        benchStreams(argc > 2 ? atol(argv[2]) : 4000000, argc > 3 ? atol(argv[3]) : 2000000);
+    else if (strcmp(argv[1], "relax") == 0)
+        benchRelax(argc > 2 ? atol(argv[2]) : 1000000);
+    else if (strcmp(argv[1], "bulk") == 0)
+        benchBulk(argc > 2 ? atol(argv[2]) : 4000000);
+    else
+    {
+        fprintf(stderr,"Invalid Benchmark\n");
+        exit(1);
+    }
+    return 0;
+}
+
+void benchLookup(long nodes, long lookups)
+{
+    char** keys = allocate(lookups * sizeof(char *));
+    Node** found = allocate(FIND_GROUP * sizeof(Node *));
+    AVL* a = buildRandom(nodes, keys, lookups);
+    long i, hits = 0;
+
+    double t = now();
+    for (i = 0; i < lookups; i++)
+        hits += findAVL(keys[i], a) != NULL;
+    double single = now() - t;
+    printf("single:  %ld lookups, %ld hits, %.1f ns/lookup\n", lookups, hits, single / lookups * 1e9);
+
+    hits = 0;
+    t = now();
+    for (i = 0; i < lookups; i += FIND_GROUP)
+    {
+        int m = lookups - i < FIND_GROUP ? lookups - i : FIND_GROUP;
+        int j;
+        findBatchAVL(keys + i, m, found, a);
+        for (j = 0; j < m; j++)
+            hits += found[j] != NULL;
+    }
+    double batched = now() - t;
+    printf("batched: %ld lookups, %ld hits, %.1f ns/lookup (group %d)\n", lookups, hits, batched / lookups * 1e9, FIND_GROUP);
+    printf("speedup: %.2fx\n", single / batched);
+
+    t = now();
+    freezeAVL(a);
+    printf("froze %d nodes in %.2f s\n", a->frozen->count, now() - t);
+
+    hits = 0;
+    t = now();
+    for (i = 0; i < lookups; i++)
+        hits += findFrozen(keys[i], a->frozen) != NULL;
+    double frozen = now() - t;
+    printf("frozen:  %ld lookups, %ld hits, %.1f ns/lookup\n", lookups, hits, frozen / lookups * 1e9);
+    printf("speedup: %.2fx\n", single / frozen);
+}
+
+void benchFilter(long nodes, long lookups)
+{
+    char** keys = allocate(lookups * sizeof(char *));
+    AVL* a = buildRandom(nodes, keys, lookups);
+    long i, hits = 0;
+
+    double t = now();
+    for (i = 0; i < lookups; i++)
+        hits += findAVL(keys[i], a) != NULL;
+    double plain = now() - t;
+    printf("tree:    %ld lookups, %ld hits, %.1f ns/lookup\n", lookups, hits, plain / lookups * 1e9);
+
+    t = now();
+    filterAVL(a);
+    printf("filtered %d keys in %.2f s, %.1f bytes/key\n", a->size, now() - t,
+           (double) a->filter->blocks * BLOOM_BLOCK / a->size);
+
+    hits = 0;
+    t = now();
+    for (i = 0; i < lookups; i++)
+    {
+        if (!checkBloom(keys[i], a->filter))
+            continue;
+        if (findAVL(keys[i], a))
+            hits++;
+        else
+            missBloom(a->filter);
+    }
+    double filtered = now() - t;
+    printf("filter:  %ld lookups, %ld hits, %.1f ns/lookup\n", lookups, hits, filtered / lookups * 1e9);
+    printf("speedup: %.2fx\n", plain / filtered);
+    reportBloom(a->filter, stdout);
+}
+
+void benchStreams(long nodes, long lookups)
+{
+    char** keys = allocate(lookups * sizeof(char *));
+    AVL* a = buildRandom(nodes, keys, lookups);
+    Shared* lock = initShared();
+    Worker workers[8];
+    Worker writer;
+    int threads, i;
+
+    for (threads = 1; threads <= 8; threads *= 2)
+    {
+        long hits = 0;
+
+        writer.a = a;
+        writer.lock = lock;
+        writer.done = 0;
+        stopWriter = 0;
+        double t = now();
+        pthread_create(&writer.thread, NULL, writeWorker, &writer);
+        for (i = 0; i < threads; i++)
+        {
+            workers[i].a = a;
+            workers[i].lock = lock;
+            workers[i].keys = keys + lookups / threads * i;
+            workers[i].count = lookups / threads;
+            workers[i].done = 0;
+            pthread_create(&workers[i].thread, NULL, readWorker, &workers[i]);
+        }
+        for (i = 0; i < threads; i++)
+        {
+            pthread_join(workers[i].thread, NULL);
+            hits += workers[i].done;
+        }
+        double elapsed = now() - t;
+        __atomic_store_n(&stopWriter, 1, __ATOMIC_RELEASE);
+        pthread_join(writer.thread, NULL);
+
+        printf("%d readers: %ld lookups, %ld hits, %.0f lookups/s, writer %ld updates, %.0f updates/s\n",
+               threads, lookups / threads * threads, hits, lookups / threads * threads / elapsed,
+               writer.done, writer.done / elapsed);
+    }
+}
+
+void* readWorker(void* arg)
+{
+    Worker* w = arg;
+    long i, j;
+
+    for (i = 0; i < w->count; i += STREAM_BATCH)
+    {
+        long end = w->count - i < STREAM_BATCH ? w->count : i + STREAM_BATCH;
+
+        readShared(w->lock);
+        for (j = i; j < end; j++)
+            w->done += findAVL(w->keys[j], w->a) != NULL;
+        doneReading(w->lock);
+    }
+    return NULL;
+}
+
+void* writeWorker(void* arg)
+{
+    Worker* w = arg;
+    char* batch[STREAM_BATCH];
+    Node probe;
+    int i;
+
+    //Each round adds a batch of new keys and takes them out again, so the tree keeps its size
+    while (!__atomic_load_n(&stopWriter, __ATOMIC_ACQUIRE))
+    {
+        for (i = 0; i < STREAM_BATCH; i++)
+            batch[i] = randomKey();
+
+        writeShared(w->lock);
+        for (i = 0; i < STREAM_BATCH; i++)
+            insertAVL(createNode(batch[i]), w->a);
+        doneWriting(w->lock);
+
+        writeShared(w->lock);
+        for (i = 0; i < STREAM_BATCH; i++)
+        {
+            probe.data = batch[i];
+            deleetAVL(&probe, w->a);
+        }
+        doneWriting(w->lock);
+        w->done += 2 * STREAM_BATCH;
+    }
+    return NULL;
+}
+
+void benchRelax(long nodes)
+{
+    char** words = allocate(nodes * sizeof(char *));
+    long i;
+
+    for (i = 0; i < nodes; i++)
+        words[i] = randomKey();
+    relaxRun(words, nodes, 0, "random");
+    relaxRun(words, nodes, 1, "random");
+    //Sorted keys are the worst case for eager inserts, a rotation almost every time
+    qsort(words, nodes, sizeof(char *), compareKeys);
+    relaxRun(words, nodes, 0, "sorted");
+    relaxRun(words, nodes, 1, "sorted");
+}
+
+void relaxRun(char** words, long nodes, int relaxed, char* order)
+{
+    AVL* a = initAVL();
+    long i;
+
+    a->relaxed = relaxed;
+    double t = now();
+    for (i = 0; i < nodes; i++)
+        insertAVL(createNode(words[i]), a);
+    settleAVL(a);
+    t = now() - t;
+    printf("%s %-7s %d nodes, %.1f ns/insert, %ld rotations, height %d\n", order,
+           relaxed ? "relaxed" : "eager", a->size, t / nodes * 1e9, a->rotations, a->root->height);
+}
+
+void benchBulk(long nodes)
+{
+    char** words = allocate(nodes * sizeof(char *));
+    Node** sorted = allocate(nodes * sizeof(Node *));
+    Node** left = allocate(nodes * sizeof(Node *));
+    Node** right = allocate(nodes * sizeof(Node *));
+    Node** parent = allocate(nodes * sizeof(Node *));
+    Node** fav = allocate(nodes * sizeof(Node *));
+    int* height = allocate(nodes * sizeof(int));
+    long i, count = 0;
+    int threads, same;
+    double serial = 0;
+
+    for (i = 0; i < nodes; i++)
+        words[i] = randomKey();
+    qsort(words, nodes, sizeof(char *), compareKeys);
+    //The builder takes each key once
+    for (i = 0; i < nodes; i++)
+        if (i == 0 || strcmp(words[i], words[i - 1]) != 0)
+            sorted[count++] = createNode(words[i]);
+
+    for (threads = 1; threads <= 8; threads *= 2)
+    {
+        AVL* a = initAVL();
+        double t = now();
+        bulkAVL(sorted, count, threads, a);
+        t = now() - t;
+        if (threads == 1)
+        {
+            serial = t;
+            for (i = 0; i < count; i++)
+            {
+                left[i] = sorted[i]->left;
+                right[i] = sorted[i]->right;
+                parent[i] = sorted[i]->parent;
+                fav[i] = sorted[i]->fav;
+                height[i] = sorted[i]->height;
+            }
+        }
+        same = 1;
+        for (i = 0; i < count; i++)
+            if (sorted[i]->left != left[i] || sorted[i]->right != right[i] || sorted[i]->parent != parent[i]
+                || sorted[i]->fav != fav[i] || sorted[i]->height != height[i])
+                same = 0;
+        printf("threads %d: %ld nodes in %.1f ms, speedup %.2f, height %d, %s tree\n", threads, count,
+               t * 1e3, serial / t, a->root->height, same ? "same" : "different");
+        free(a->hot);
+        free(a);
+    }
+}
+
+int compareKeys(const void* x, const void* y)
+{
+    return strcmp(*(char * const *) x, *(char * const *) y);
+}
+
+AVL* buildRandom(long nodes, char** keys, long lookups)
+{
+    AVL* a = initAVL();
+    long i;
+
+    char** words = allocate(nodes * sizeof(char *));
+
+    //Keys are made before any node, as the compiled and threaded modes do
+    double t = now();
+    for (i = 0; i < nodes; i++)
+    {
+        words[i] = randomKey();
+        //Even lookup slots get resident keys
+        if (i % 2 == 0 && i < lookups)
+            keys[i] = words[i];
+    }
+    for (i = 0; i < nodes; i++)
+        insertAVL(createNode(words[i]), a);
+    free(words);
+    for (i = 0; i < lookups; i++)
+        if (i % 2 || i >= nodes)
+            keys[i] = randomKey();
+    //Shuffle so hits land in random order across the tree
+    for (i = lookups - 1; i > 0; i--)
+    {
+        long j = rand() % (i + 1);
+        char* k = keys[i];
+        keys[i] = keys[j];
+        keys[j] = k;
+    }
+    printf("built %d nodes (height %d) in %.2f s\n", a->size, a->root->height, now() - t);
+    return a;
+}
+
+char* randomKey(void)
+{
+    int len = 8 + rand() % 8;
+    char* k = allocate(len + 1);
+    int i;
+
+    for (i = 0; i < len; i++)
+        k[i] = 'a' + rand() % 26;
+    k[len] = 0;
+    return k;
+}
+
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
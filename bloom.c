@@ -0,0 +1,140 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bloom.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * bloom.c   - c file for the counting Bloom filter
+ *           - written by Ben Lindow
+ *
+ *    hash(char *);
+ *      - 64 bit FNV-1a string hash with a final mix, the low bits pick the block,
+ *      - the high bits the counters
+ *      - returns the hash value
+ *      - usage example: uint64_t h = hash(str);
+
+ *    block(uint64_t, Bloom *);
+ *      - finds the block of counters for a hash
+ *      - returns a pointer to the first counter in the block
+ *      - usage example: unsigned char* c = block(h, filter);
+ */
+
+static uint64_t hash(char *);
+static unsigned char* block(uint64_t, Bloom *);
+
+Bloom* initBloom(int keys)
+{
+    Bloom* f = allocate(sizeof(Bloom));
+    void* counts;
+
+    f->blocks = 1;
+    while ((long) f->blocks * BLOOM_LOAD < keys)
+        f->blocks *= 2;
+    if (posix_memalign(&counts, BLOOM_BLOCK, (size_t) f->blocks * BLOOM_BLOCK) != 0)
+    {
+        fprintf(stderr,"out of memory");
+        exit(-1);
+    }
+    f->counts = counts;
+    memset(f->counts, 0, (size_t) f->blocks * BLOOM_BLOCK);
+    f->keys = 0;
+    f->checks = 0;
+    f->rejects = 0;
+    f->misses = 0;
+    return f;
+}
+
+void addBloom(char* str, Bloom* f)
+{
+    uint64_t h = hash(str);
+    unsigned char* c = block(h, f);
+    int i;
+
+    for (i = 0; i < BLOOM_PROBES; i++)
+    {
+        unsigned char* p = &c[(h >> (40 + 6 * i)) & (BLOOM_BLOCK - 1)];
+        if (*p < 255)
+            (*p)++;
+    }
+    f->keys++;
+}
+
+void removeBloom(char* str, Bloom* f)
+{
+    uint64_t h = hash(str);
+    unsigned char* c = block(h, f);
+    int i;
+
+    for (i = 0; i < BLOOM_PROBES; i++)
+    {
+        unsigned char* p = &c[(h >> (40 + 6 * i)) & (BLOOM_BLOCK - 1)];
+        //A saturated counter has lost count, so it stays set
+        if (*p < 255)
+            (*p)--;
+    }
+    f->keys--;
+}
+
+int checkBloom(char* str, Bloom* f)
+{
+    uint64_t h = hash(str);
+    unsigned char* c = block(h, f);
+    int i;
+
+    f->checks++;
+    for (i = 0; i < BLOOM_PROBES; i++)
+    {
+        if (!c[(h >> (40 + 6 * i)) & (BLOOM_BLOCK - 1)])
+        {
+            f->rejects++;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void missBloom(Bloom* f)
+{
+    f->misses++;
+}
+
+int fullBloom(Bloom* f)
+{
+    return f->keys > (long) f->blocks * BLOOM_LOAD;
+}
+
+void reportBloom(Bloom* f, FILE* out)
+{
+    long absent = f->rejects + f->misses;
+
+    fprintf(out, "filter: %ld lookups, %ld rejected, %ld false positives (%.2f%% of absent keys), %d keys in %u blocks\n",
+            f->checks, f->rejects, f->misses, absent ? 100.0 * f->misses / absent : 0.0, f->keys, f->blocks);
+}
+
+void freeBloom(Bloom* f)
+{
+    free(f->counts);
+    free(f);
+}
+
+static uint64_t hash(char* str)
+{
+    uint64_t h = 14695981039346656037ull;
+    while (*str)
+        h = (h ^ (unsigned char) *str++) * 1099511628211ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+static unsigned char* block(uint64_t h, Bloom* f)
+{
+    return f->counts + (size_t) (h & (f->blocks - 1)) * BLOOM_BLOCK;
+}
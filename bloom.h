@@ -0,0 +1,77 @@
+/* VERSION 1.0
+ *
+ * bloom.h   - header file for the counting Bloom filter
+ *           - written by Ben Lindow
+ *
+ *    A blocked counting Bloom filter over the distinct keys of a tree.  A
+ *    key hashes to one 64-byte block of byte counters and BLOOM_PROBES
+ *    counters inside it, so a check touches a single cache line.  Counters
+ *    stick once they reach 255, so removing keys never causes a false
+ *    negative.  The tree refills the filter at twice the size when it holds
+ *    more than BLOOM_LOAD keys per block.
+ *
+ *    initBloom(int);
+ *      - constructor for a filter sized for at least the given number of keys
+ *      - returns a malloc'd filter object
+ *      - usage example: Bloom* f = initBloom(tree->size);
+ *
+ *    addBloom(char *, Bloom *);
+ *      - counts a key that was added to the tree
+ *      - usage example: addBloom(str, filter);
+ *
+ *    removeBloom(char *, Bloom *);
+ *      - uncounts a key that was removed from the tree
+ *      - usage example: removeBloom(str, filter);
+ *
+ *    checkBloom(char *, Bloom *);
+ *      - returns 0 if the key is certainly not in the tree, else 1
+ *      - usage example: if (!checkBloom(str, filter)) ...
+ *
+ *    missBloom(Bloom *);
+ *      - records that a key passed by checkBloom was not in the tree
+ *      - usage example: missBloom(filter);
+ *
+ *    fullBloom(Bloom *);
+ *      - returns 1 if the filter holds more keys than it was sized for, else 0
+ *      - usage example: if (fullBloom(filter)) ...
+ *
+ *    reportBloom(Bloom *, FILE *);
+ *      - prints lookups, rejections and the false positive rate
+ *      - usage example: reportBloom(filter, stderr);
+ *
+ *    freeBloom(Bloom *);
+ *      - frees a filter
+ *      - usage example: freeBloom(filter);
+ *
+ */
+
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdio.h>
+
+#define BLOOM_BLOCK 64
+#define BLOOM_PROBES 4
+#define BLOOM_LOAD 4
+
+typedef struct Bloom
+{
+    unsigned char* counts;
+    unsigned blocks;
+    int keys;
+
+    long checks;
+    long rejects;
+    long misses;
+} Bloom;
+
+extern Bloom* initBloom(int);
+extern void addBloom(char *, Bloom *);
+extern void removeBloom(char *, Bloom *);
+extern int checkBloom(char *, Bloom *);
+extern void missBloom(Bloom *);
+extern int fullBloom(Bloom *);
+extern void reportBloom(Bloom *, FILE *);
+extern void freeBloom(Bloom *);
+
+#endif
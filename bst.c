@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "bst.h"
+#include "counters.h"
 
 /* VERSION 1.0
  *
@@ -63,20 +64,30 @@
  *      - returns 0 if tree is empty, else 1.
  *      - usage example: int x = isEmptyTree(tree);
 
- *    getStats(AVL *);
- *      - uses tree traversal to gather information and store in tree
- *      - usage example: getStats(tree);
+ *    getStats(BST *, int *, int *, double *);
+ *      - uses tree traversal to find the closest and furthest null child and the
+ *      - average depth by frequency, without writing to the tree
+ *      - usage example: getStats(tree, &min, &height, &depth);
  
- *    printNode(Node *);
+ *    printNode(Node *, FILE *);
  *      - prints node information in a specific format
- *      - usage example: printNode(node);
+ *      - usage example: printNode(node, out);
  
  
  *    findSuc(Node *);
  *      - generic function to find successor of a node
  *      - returns pointer to a successor, else NULL
  *      - usage example: Node* s = findSuc(node);
- 
+
+ *    bisect(Node **, long long *, int, int, Node *);
+ *      - links sorted[lo..hi] into a weight-balanced subtree under parent
+ *      - returns the root of the subtree, or NULL if the range is empty
+ *      - usage example: Node* r = bisect(sorted, prefix, 0, n - 1, NULL);
+
+ *    mayHave(char *, BST *);
+ *      - asks the filter, if any, whether a key could be in the tree
+ *      - returns 0 if the key is certainly absent, else 1
+ *      - usage example: if(!mayHave(str, tree)) ...
  */
 
 static Node* climb(Node *, BST *);
@@ -92,8 +103,10 @@ static void newSingleRoot(Node *, BST* b);
 static void newDoubleRoot(Node *, BST* b);
 static void removeDouble(Node* n, BST* b);
 static int isEmptyTree(BST *);
-static void getStats(BST *);
-static void printNode(Node *);
+static void getStats(BST *, int *, int *, double *);
+static void printNode(Node *, FILE *);
+static Node* bisect(Node **, long long *, int, int, Node *);
+static int mayHave(char *, BST *);
 
 
 BST* initBST(void)
@@ -102,135 +115,244 @@ BST* initBST(void)
     if (b == 0) { fprintf(stderr,"out of memory"); exit(-1); }
 
     b->size = 0;
-    b->height = 0;
-    b->min = -1;
     b->root = NULL;
+    b->out = stdout;
+    b->filter = NULL;
+    b->hot = initCache();
     return b;
 }
 
 void insert(Node* n, BST* b)
 {
+    int size = b->size;
+    Node* t;
+
+    //Repeat keys skip the descent
+    if ((t = findCache(n->data, b->hot)))
+    {
+        t->freq += n->freq;
+        return;
+    }
     if (!b->root)
     {
         b->root = n;
         n->parent = n;
         b->size++;
-        return;
     }
     else
-        put(n, climb(n, b), b);
+    {
+        t = climb(n, b);
+        put(n, t, b);
+        //Only keys seen twice are cached, so one-off words don't evict hot ones
+        if (b->size == size)
+            fillCache(t, b->hot);
+    }
+
+    if (b->filter && b->size > size)
+    {
+        addBloom(n->data, b->filter);
+        if (fullBloom(b->filter))
+            filterBST(b);
+    }
 }
 
 void printTree(BST* b)
 {
-    if(isEmptyTree(b)) {return;}
+    showTree(b->out, b);
+}
+
+void showTree(FILE* out, BST* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
 
     Queue* q = initQueue();
+    Visit v;
     Node* n;
     int level = -1;
     
-    enqueue(b->root, q);
-    b->root->level = 0;
-    
+    enqueue(b->root, b->root, 0, q);
     
     while(q->size > 0)
     {
-        n = dequeue(q);
+        v = dequeue(q);
+        n = v.node;
         
-        if(n->level != level)
+        if(v.depth != level)
         {
             if(level != -1)
-                printf("\n");
-            printf("%d: ", ++level);
+                fprintf(out, "\n");
+            fprintf(out, "%d: ", ++level);
         }
         
-        printNode(n);
+        printNode(n, out);
         
         if(n->left)
-        {
-            enqueue(n->left, q);
-            n->left->level = n->level + 1;
-        }
-        
+            enqueue(n->left, n, v.depth + 1, q);
         if(n->right)
-        {
-            enqueue(n->right, q);
-            n->right->level = n->level + 1;
-        }
+            enqueue(n->right, n, v.depth + 1, q);
     }
+    freeQueue(q);
 }
 
 void printStats(BST* b)
 {
-    if(isEmptyTree(b)) {return;}
-    getStats(b);
-    printf("\nNumber of Nodes in BST: %d\n", b->size);
-    printf("Distance to Closest Null Child: %d\n", b->min);
-    printf("Distance to Furthest Null Child: %d\n", b->height);
+    showStats(b->out, b);
+}
+
+void showStats(FILE* out, BST* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
+
+    int min, height;
+    double depth;
+
+    getStats(b, &min, &height, &depth);
+    fprintf(out, "\nNumber of Nodes in BST: %d\n", b->size);
+    fprintf(out, "Distance to Closest Null Child: %d\n", min);
+    fprintf(out, "Distance to Furthest Null Child: %d\n", height);
+    fprintf(out, "Average Depth by Frequency: %.2f\n", depth);
+}
+void reweighBST(BST* b)
+{
+    if(!b->root) {return;}
+
+    int count;
+    Node** sorted = inorderNodes(b->root, &count);
+    long long* prefix = malloc((b->size + 1) * sizeof(long long));
+    if (prefix == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+    int i;
+
+    prefix[0] = 0;
+    for(i = 0; i < count; i++)
+        prefix[i + 1] = prefix[i] + sorted[i]->freq;
+
+    b->root = bisect(sorted, prefix, 0, count - 1, NULL);
+    free(sorted);
+    free(prefix);
+}
+void filterBST(BST* b)
+{
+    Bloom* f = initBloom(2 * b->size);
+    int count, i;
+
+    if(b->root)
+    {
+        Node** all = inorderNodes(b->root, &count);
+        for(i = 0; i < count; i++)
+            addBloom(all[i]->data, f);
+        free(all);
+    }
+    if(b->filter)
+    {
+        f->checks = b->filter->checks;
+        f->rejects = b->filter->rejects;
+        f->misses = b->filter->misses;
+        freeBloom(b->filter);
+    }
+    b->filter = f;
 }
 
 void printFreq(Node* n, BST* b)
 {
     if (isEmptyTree(b)) {return;}
+    if (!mayHave(n->data, b)) { fprintf(b->out, "The string \"%s\" does not exist.\n", n->data); return; }
     Node* ptr = climb(n, b);
 
-    if(strcmp(n->data, ptr->data) == 0)
-        printf("\"%s\" has frequency %d\n", ptr->data, ptr->freq);
+    if(compareKey(n->data, ptr->data) == 0)
+        fprintf(b->out, "\"%s\" has frequency %d\n", ptr->data, ptr->freq);
     else
-        printf("The string \"%s\" does not exist.\n", n->data);
+    {
+        if(b->filter)
+            missBloom(b->filter);
+        fprintf(b->out, "The string \"%s\" does not exist.\n", n->data);
+    }
         
 }
 
+void showFreq(char* str, FILE* out, BST* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
+
+    Node probe;
+    probe.data = str;
+    Node* ptr = climb(&probe, b);
+
+    if(compareKey(str, ptr->data) == 0)
+        fprintf(out, "\"%s\" has frequency %d\n", ptr->data, ptr->freq);
+    else
+        fprintf(out, "The string \"%s\" does not exist.\n", str);
+}
+
+void showRange(char* lo, char* hi, FILE* out, BST* b)
+{
+    if(!b->root) { fprintf(out, "Empty Tree!\n"); return;}
+
+    if(!listRange(b->root, lo, hi, out))
+        fprintf(out, "No strings from \"%s\" to \"%s\".\n", lo, hi);
+}
+
 void deleet(Node* ptr, BST* b)
 {
     if(isEmptyTree(b)) {return;}
+    if(!mayHave(ptr->data, b)) { fprintf(b->out, "The string \"%s\" does not exist.\n", ptr->data); return; }
 
     Node* n = climb(ptr, b);
-    if(strcmp(n->data, ptr->data) != 0) { printf("The string \"%s\" does not exist.\n", ptr->data); return; }
+    if(compareKey(n->data, ptr->data) != 0)
+    {
+        if(b->filter)
+            missBloom(b->filter);
+        fprintf(b->out, "The string \"%s\" does not exist.\n", ptr->data);
+        return;
+    }
 
     n->freq--;
 
     if(!n->freq)
     {
+        if(b->filter)
+            removeBloom(n->data, b->filter);
+        dropCache(n->data, b->hot);
         removeNode(n, b);
         b->size--;
     }
 }
 
-static void printNode(Node* n)
+static void printNode(Node* n, FILE* out)
 {
     if(isLeaf(n))
-        printf("=");
-    printf("%s(%s)%d%c ", n->data, n->parent->data, n->freq, leftOrRight(n));
+        fprintf(out, "=");
+    fprintf(out, "%s(%s)%d%c ", n->data, n->parent->data, n->freq, leftOrRight(n));
 }
 
-static void getStats(BST* b)
+static void getStats(BST* b, int* min, int* height, double* depth)
 {
-    isEmptyTree(b);
-    
     Queue* q = initQueue();
-    Queue* lq = initQueue();
+    Visit v;
     Node* n;
-    
-    enqueue(b->root, q);
-    b->root->level = 0;
+    long long sum = 0, weight = 0;
+
+    *min = -1;
+    enqueue(b->root, b->root, 0, q);
     
     while(q->size > 0)
     {
-        n = dequeue(q);
-        
+        v = dequeue(q);
+        n = v.node;
+        sum += (long long) n->freq * v.depth;
+        weight += n->freq;
         if(!n->left || !n->right)
-            enqueue(n, lq);
-        
+        {
+            if(*min == -1)
+                *min = v.depth;
+            *height = v.depth;
+        }
         if(n->left)
-            enqueue(n->left, q);
-        
+            enqueue(n->left, n, v.depth + 1, q);
         if(n->right)
-            enqueue(n->right, q);
-    
+            enqueue(n->right, n, v.depth + 1, q);
     }
-    b->min = lq->head->level;
-    b->height = lq->tail->level;
+    *depth = (double) sum / weight;
+    freeQueue(q);
 }
 
 
@@ -240,9 +362,10 @@ static Node* climb(Node* n, BST* b)
 
     while(ptr)
     {
-        if(strcmp(n->data, ptr->data) < 0 && ptr->left)
+        COUNT(visits);
+        if(compareKey(n->data, ptr->data) < 0 && ptr->left)
             ptr = ptr->left;
-        else if(strcmp(n->data, ptr->data) > 0 && ptr->right)
+        else if(compareKey(n->data, ptr->data) > 0 && ptr->right)
             ptr = ptr->right;
         else
             break;
@@ -252,16 +375,16 @@ static Node* climb(Node* n, BST* b)
 
 static void put(Node* n, Node* t, BST* b)
 {   //If Equal, Update Freq and Return
-    if(strcmp(n->data, t->data) == 0)
+    if(compareKey(n->data, t->data) == 0)
     {
-        t->freq++;
+        t->freq += n->freq;
         return;
     }
     //Add Left
-    if(strcmp(n->data, t->data) < 0)
+    if(compareKey(n->data, t->data) < 0)
         t->left = n;
     //Add Right
-    else if(strcmp(n->data, t->data) > 0)
+    else if(compareKey(n->data, t->data) > 0)
         t->right = n;
 
     n->parent = t;
@@ -415,7 +538,7 @@ static char leftOrRight(Node* n)
     Node* p = n->parent;
     if (n == p)
         return 'X';
-    else if (p->left && strcmp(p->left->data, n->data) == 0)
+    else if (p->left == n)
         return 'L';
     else
         return 'R';
@@ -449,9 +572,35 @@ static int isEmptyTree(BST* b)
 {
     if(!b->root)
     {
-        printf("Empty Tree!\n");
+        fprintf(b->out, "Empty Tree!\n");
         return 1;
     }
     else
         return 0;
 }
+static Node* bisect(Node** sorted, long long* prefix, int lo, int hi, Node* parent)
+{
+    if(lo > hi) {return NULL;}
+
+    //Root is the key whose frequency interval holds the subtree's midpoint
+    long long mid = (prefix[lo] + prefix[hi + 1]) / 2;
+    int l = lo, h = hi;
+    while(l < h)
+    {
+        int m = l + (h - l) / 2;
+        if(prefix[m + 1] > mid)
+            h = m;
+        else
+            l = m + 1;
+    }
+
+    Node* n = sorted[l];
+    n->parent = parent ? parent : n;
+    n->left = bisect(sorted, prefix, lo, l - 1, n);
+    n->right = bisect(sorted, prefix, l + 1, hi, n);
+    return n;
+}
+static int mayHave(char* str, BST* b)
+{
+    return !b->filter || checkBloom(str, b->filter);
+}
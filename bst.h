@@ -1,8 +1,12 @@
 #ifndef BST_H
 #define BST_H
 
+#include <stdio.h>
+
 #include "node.h"
 #include "queue.h"
+#include "bloom.h"
+#include "cache.h"
 
 /* VERSION 1.0
  *
@@ -20,6 +24,8 @@
  *
  *    insert(Node *, AVL *);
  *      - inserts a new node into BST tree
+ *      - a key already in the tree gains the node's frequency, 1 from createNode
+ *      - a key already inserted twice is usually found in the hot key cache without a descent
  *      - usage example: insertAVL(node, tree);
  *
  *    printTree(AVL *)
@@ -27,22 +33,46 @@
  *      - usage example: printTreeAVL(tree);
  *
  *    printStats(AVL *);
- *      - prints distances to shortest null child, furthest null child, and total nodes in tree
+ *      - prints distances to shortest null child, furthest null child, total nodes in tree,
+ *      - and the average depth of a key weighted by its frequency
  *      - usage example: printStatsAVL(tree);
  *
  *    deleet(Node *, AVL *);
  *      - deletes a node from an BST tree
  *      - usage example: deleetAVL(node, tree);
  *
+ *    showFreq(char *, FILE *, BST *);
+ *    showRange(char *, char *, FILE *, BST *);
+ *    showTree(FILE *, BST *);
+ *    showStats(FILE *, BST *);
+ *      - f, l, s and r written to out without touching the tree or its filter statistics,
+ *      - so any number of threads may run them at once while no thread changes the tree
+ *      - usage example: showFreq(str, out, tree);
+ *
+ *    reweighBST(BST *);
+ *      - rebuilds the tree from its keys in weight-balanced shape (Mehlhorn's bisection
+ *      - rule): each subtree root is the key holding the middle of the subtree's total
+ *      - frequency, so frequent keys sit near the root and a key of frequency w out of
+ *      - W ends up within about log2(W/w) + 1 levels
+ *      - usage example: reweighBST(tree);
+ *
+ *    filterBST(BST *);
+ *      - puts a counting Bloom filter in front of the tree, or regrows the one there,
+ *      - sized for twice the current keys; insert and delete keep it current and
+ *      - f and d answer keys it rules out without descending
+ *      - usage example: filterBST(tree);
+ *
  */
 
 
 typedef struct BST
 {
     Node* root;
-    int height;
-    int min;
     int size;
+    FILE* out;
+
+    Bloom* filter;
+    Cache* hot;
 } BST;
 
 extern BST* initBST(void);
@@ -51,5 +81,11 @@ extern void insert(Node *, BST *);
 extern void printTree(BST *);
 extern void deleet(Node *, BST *);
 extern void printStats(BST *);
+extern void showFreq(char *, FILE *, BST *);
+extern void showRange(char *, char *, FILE *, BST *);
+extern void showTree(FILE *, BST *);
+extern void showStats(FILE *, BST *);
+extern void reweighBST(BST *);
+extern void filterBST(BST *);
 
 #endif
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * cache.c   - c file for the hot key cache
+ *           - written by Ben Lindow
+ *
+ *    hash(char *);
+ *      - hashString, folded so the low bits pick the slot
+ *      - returns the hash value
+ *      - usage example: unsigned h = hash(str);
+ */
+
+static unsigned hash(char *);
+
+Cache* initCache(void)
+{
+    Cache* c = allocate(sizeof(Cache));
+    memset(c, 0, sizeof(Cache));
+    return c;
+}
+
+Node* findCache(char* str, Cache* c)
+{
+    unsigned h = hash(str);
+    CacheSlot* s = &c->slots[h & (CACHE_SLOTS - 1)];
+
+    if (s->node && s->hash == h && strcmp(s->node->data, str) == 0)
+        return s->node;
+    return NULL;
+}
+
+void fillCache(Node* n, Cache* c)
+{
+    unsigned h = hash(n->data);
+    CacheSlot* s = &c->slots[h & (CACHE_SLOTS - 1)];
+
+    s->hash = h;
+    s->node = n;
+}
+
+void dropCache(char* str, Cache* c)
+{
+    unsigned h = hash(str);
+    CacheSlot* s = &c->slots[h & (CACHE_SLOTS - 1)];
+
+    if (s->hash == h)
+        s->node = NULL;
+}
+
+static unsigned hash(char* str)
+{
+    unsigned h = hashString(str);
+    return h ^ (h >> 16);
+}
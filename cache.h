@@ -0,0 +1,56 @@
+/* VERSION 1.0
+ *
+ * cache.h   - header file for the hot key cache
+ *           - written by Ben Lindow
+ *
+ *    A direct-mapped cache from a key's hash to the node holding it, so a
+ *    word the corpus repeats ("the", "and", "of") is found with one hash
+ *    and one compare instead of a descent from the root.  Entries are
+ *    checked against the node's key on every hit, so an entry whose node
+ *    has since taken another key just misses; a tree drops the entry for a
+ *    key it removes.
+ *
+ *    initCache(void);
+ *      - constructor for an empty cache
+ *      - returns a malloc'd cache object
+ *      - usage example: Cache* c = initCache();
+ *
+ *    findCache(char *, Cache *);
+ *      - looks up a key
+ *      - returns the cached node holding the key, else NULL
+ *      - usage example: Node* n = findCache(str, cache);
+ *
+ *    fillCache(Node *, Cache *);
+ *      - caches a node under its key, evicting whatever shared the slot
+ *      - usage example: fillCache(node, cache);
+ *
+ *    dropCache(char *, Cache *);
+ *      - forgets a key
+ *      - usage example: dropCache(str, cache);
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "node.h"
+
+#define CACHE_SLOTS 4096
+
+typedef struct CacheSlot
+{
+    unsigned hash;
+    Node* node;
+} CacheSlot;
+
+typedef struct Cache
+{
+    CacheSlot slots[CACHE_SLOTS];
+} Cache;
+
+extern Cache* initCache(void);
+extern Node* findCache(char *, Cache *);
+extern void fillCache(Node *, Cache *);
+extern void dropCache(char *, Cache *);
+
+#endif
@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <stdio_ext.h>
+
+#include "corpus.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * corpus.c  - c file for reading many corpus files at once
+ *           - written by Ben Lindow
+ *
+ *    work(void *);
+ *      - worker thread body, tokenizes the next file not yet taken until none are left
+ *      - usage example: pthread_create(&t, NULL, work, c);
+
+ *    tokenize(char *, Words *, char *(*)(FILE *));
+ *      - reads a whole file and collects its distinct words with their counts
+ *      - usage example: tokenize(c->files[i], &c->words[i], c->read);
+
+ *    tally(Words *, char *, int **, unsigned *);
+ *      - adds one appearance of a word, growing the table as it fills
+ *      - usage example: tally(w, str, &table, &mask);
+ */
+
+static void* work(void *);
+static void tokenize(char *, Words *, char *(*)(FILE *));
+static void tally(Words *, char *, int **, unsigned *);
+
+Corpus* startCorpus(char** files, int count, int threads, char* (*read)(FILE *))
+{
+    Corpus* c = allocate(sizeof(Corpus));
+    int i;
+
+    c->files = files;
+    c->count = count;
+    c->words = allocate(count * sizeof(Words));
+    memset(c->words, 0, count * sizeof(Words));
+    c->next = 0;
+    c->taken = 0;
+    c->ahead = CORPUS_AHEAD * threads;
+    c->read = read;
+    pthread_mutex_init(&c->mutex, NULL);
+    pthread_cond_init(&c->filled, NULL);
+    pthread_cond_init(&c->drained, NULL);
+
+    //More workers than files would only sleep
+    c->threadCount = threads < count ? threads : count;
+    c->threads = allocate(c->threadCount * sizeof(pthread_t));
+    for (i = 0; i < c->threadCount; i++)
+    {
+        if (pthread_create(&c->threads[i], NULL, work, c) != 0)
+        {
+            fprintf(stderr,"could not start worker thread\n");
+            exit(5);
+        }
+    }
+    return c;
+}
+
+Words* nextFile(Corpus* c)
+{
+    int i;
+
+    if (c->taken == c->count)
+    {
+        for (i = 0; i < c->threadCount; i++)
+            pthread_join(c->threads[i], NULL);
+        pthread_mutex_destroy(&c->mutex);
+        pthread_cond_destroy(&c->filled);
+        pthread_cond_destroy(&c->drained);
+        free(c->threads);
+        free(c->words);
+        free(c);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->words[c->taken].ready)
+        pthread_cond_wait(&c->filled, &c->mutex);
+    pthread_mutex_unlock(&c->mutex);
+    return &c->words[c->taken];
+}
+
+void doneFile(Corpus* c)
+{
+    Words* w = &c->words[c->taken];
+
+    free(w->keys);
+    free(w->counts);
+    w->keys = NULL;
+    w->counts = NULL;
+
+    pthread_mutex_lock(&c->mutex);
+    c->taken++;
+    pthread_cond_broadcast(&c->drained);
+    pthread_mutex_unlock(&c->mutex);
+}
+
+static void* work(void* arg)
+{
+    Corpus* c = arg;
+    int i;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&c->mutex);
+        while (c->next < c->count && c->next >= c->taken + c->ahead)
+            pthread_cond_wait(&c->drained, &c->mutex);
+        if (c->next == c->count)
+        {
+            pthread_mutex_unlock(&c->mutex);
+            return NULL;
+        }
+        i = c->next++;
+        pthread_mutex_unlock(&c->mutex);
+
+        tokenize(c->files[i], &c->words[i], c->read);
+
+        pthread_mutex_lock(&c->mutex);
+        c->words[i].ready = 1;
+        pthread_cond_broadcast(&c->filled);
+        pthread_mutex_unlock(&c->mutex);
+    }
+}
+
+static void tokenize(char* fname, Words* w, char* (*read)(FILE *))
+{
+    FILE* fp = fopen(fname, "r");
+    unsigned mask = 1023;
+    int* table;
+    long len;
+
+    if (!fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    //The whole file is wanted, front to back, so the kernel can fetch it all now
+    posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_WILLNEED);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = allocate(len + 1);
+    if (fread(text, 1, len, fp) != (size_t) len)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    fclose(fp);
+
+    w->keys = allocate((mask + 1) * sizeof(char *));
+    w->counts = allocate((mask + 1) * sizeof(int));
+    w->count = 0;
+    if (len == 0)
+    {
+        free(text);
+        return;
+    }
+
+    table = allocate((mask + 1) * sizeof(int));
+    memset(table, -1, (mask + 1) * sizeof(int));
+    fp = fmemopen(text, len, "r");
+    if (!fp) { fprintf(stderr,"out of memory"); exit(-1); }
+    //Only this worker reads the file, so skip stdio's per-character locks
+    __fsetlocking(fp, FSETLOCKING_BYCALLER);
+    char* str = read(fp);
+
+    while (!feof(fp))
+    {
+        if (strcmp(str, "") == 0)
+            free(str);
+        else
+            tally(w, str, &table, &mask);
+        str = read(fp);
+    }
+    free(str);
+    fclose(fp);
+    free(table);
+    free(text);
+}
+
+static void tally(Words* w, char* str, int** table, unsigned* mask)
+{
+    unsigned h = hashString(str) & *mask;
+    int i;
+
+    while ((*table)[h] != -1)
+    {
+        if (strcmp(w->keys[(*table)[h]], str) == 0)
+        {
+            w->counts[(*table)[h]]++;
+            free(str);
+            return;
+        }
+        h = (h + 1) & *mask;
+    }
+    (*table)[h] = w->count;
+    w->keys[w->count] = str;
+    w->counts[w->count++] = 1;
+
+    //Keep the table at most half full; the word arrays grow with it
+    if (2 * (unsigned) w->count > *mask)
+    {
+        *mask = 2 * *mask + 1;
+        free(*table);
+        *table = allocate((*mask + 1) * sizeof(int));
+        memset(*table, -1, (*mask + 1) * sizeof(int));
+        w->keys = reallocate(w->keys, (*mask + 1) * sizeof(char *));
+        w->counts = reallocate(w->counts, (*mask + 1) * sizeof(int));
+        for (i = 0; i < w->count; i++)
+        {
+            h = hashString(w->keys[i]) & *mask;
+            while ((*table)[h] != -1)
+                h = (h + 1) & *mask;
+            (*table)[h] = i;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/* VERSION 1.0
+ *
+ * corpus.h  - header file for reading many corpus files at once
+ *           - written by Ben Lindow
+ *
+ *    Worker threads take the corpus files in turn, each reading a whole file
+ *    in one go, with the kernel told to read it ahead, and tokenizing it
+ *    into its distinct words in order of first appearance with how often
+ *    each appears.  The tree thread takes the files back in the order they
+ *    were given, so inserting each word once with its count builds the
+ *    same tree as reading the files one after another: repeats never
+ *    change a tree's shape.  Workers run at most CORPUS_AHEAD files per
+ *    thread ahead of the tree thread, so memory stays bounded however many
+ *    files there are.
+ *
+ *    startCorpus(char **, int, int, char *(*)(FILE *));
+ *      - starts the given number of workers on the files, reading tokens with read
+ *      - returns a malloc'd corpus object
+ *      - usage example: Corpus* c = startCorpus(files, count, 4, readStream);
+ *
+ *    nextFile(Corpus *);
+ *      - waits for the next file, in order, to be tokenized
+ *      - returns its words, whose keys are the caller's to keep or free, or NULL
+ *      - once every file has been taken and the corpus is freed
+ *      - usage example: Words* w = nextFile(c);
+ *
+ *    doneFile(Corpus *);
+ *      - frees the arrays of the words returned by nextFile, so a worker can move on
+ *      - usage example: doneFile(c);
+ *
+ */
+
+#define CORPUS_AHEAD 4
+
+typedef struct Words
+{
+    char** keys;
+    int* counts;
+    int count;
+    int ready;
+} Words;
+
+typedef struct Corpus
+{
+    char** files;
+    Words* words;
+    int count;
+    int next;
+    int taken;
+    int ahead;
+    char* (*read)(FILE *);
+
+    pthread_t* threads;
+    int threadCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;
+    pthread_cond_t drained;
+} Corpus;
+
+extern Corpus* startCorpus(char **, int, int, char *(*)(FILE *));
+extern Words* nextFile(Corpus *);
+extern void doneFile(Corpus *);
+
+#endif
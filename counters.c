@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "counters.h"
+
+/* VERSION 1.0
+ *
+ * counters.c - c file for the operation counters
+ *            - written by Ben Lindow
+ *
+ */
+
+#ifdef COUNTERS
+Counters counters;
+#endif
+
+void printCounters(FILE* out)
+{
+#ifdef COUNTERS
+    fprintf(out, "Compares: %ld\n", counters.compares);
+    fprintf(out, "Nodes Visited: %ld\n", counters.visits);
+    fprintf(out, "Insert Rotations: %ld linear, %ld nonlinear\n", counters.insertLinear, counters.insertNonlinear);
+    fprintf(out, "Delete Rotations: %ld linear, %ld nonlinear\n", counters.deleteLinear, counters.deleteNonlinear);
+    fprintf(out, "Join Rotations: %ld\n", counters.joinRotations);
+    fprintf(out, "Fixup Steps: %ld insert, %ld delete\n", counters.insertFixups, counters.deleteFixups);
+    fprintf(out, "Allocations: %ld of %ld bytes\n", counters.allocations, counters.bytes);
+#else
+    fprintf(out, "Counters are not built in, build with make COUNTERS=1\n");
+#endif
+}
+
+void resetCounters(void)
+{
+#ifdef COUNTERS
+    memset(&counters, 0, sizeof(Counters));
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+#include <string.h>
+
+/* VERSION 1.0
+ *
+ * counters.h - header file for the operation counters
+ *            - written by Ben Lindow
+ *
+ *    Counts the work the trees do: key comparisons, nodes stepped through
+ *    on the way down, rotations split by kind and by whether an insert or
+ *    a delete caused them, rotations made by joins, fixup passes, and the
+ *    allocations made through allocate and createNode with their bytes.  The counters are only
+ *    built in when COUNTERS is defined (make COUNTERS=1); otherwise every
+ *    COUNT compiles to nothing and compareKey is plain strcmp.  Counts
+ *    are relaxed atomic adds, so threads running at once lose none.
+ *
+ *    COUNT(field);
+ *      - adds one to a counter
+ *      - usage example: COUNT(visits);
+ *
+ *    COUNT_BYTES(size_t);
+ *      - counts one allocation of the given size
+ *      - usage example: COUNT_BYTES(sizeof(Node));
+ *
+ *    compareKey(char *, char *);
+ *      - strcmp that counts itself
+ *      - returns the same as strcmp
+ *      - usage example: int c = compareKey(str, ptr->data);
+ *
+ *    printCounters(FILE *);
+ *      - prints every counter, or a note that the counters are not built in
+ *      - usage example: printCounters(stdout);
+ *
+ *    resetCounters(void);
+ *      - sets every counter back to zero
+ *      - usage example: resetCounters();
+ *
+ */
+
+typedef struct Counters
+{
+    long compares;
+    long visits;
+    long insertLinear;
+    long insertNonlinear;
+    long deleteLinear;
+    long deleteNonlinear;
+    long joinRotations;
+    long insertFixups;
+    long deleteFixups;
+    long allocations;
+    long bytes;
+} Counters;
+
+#ifdef COUNTERS
+extern Counters counters;
+#define COUNT(field) ((void) __atomic_fetch_add(&counters.field, 1, __ATOMIC_RELAXED))
+#define COUNT_BYTES(size) (COUNT(allocations), (void) __atomic_fetch_add(&counters.bytes, (long) (size), __ATOMIC_RELAXED))
+#define compareKey(x, y) (COUNT(compares), strcmp((x), (y)))
+#else
+#define COUNT(field) ((void) 0)
+#define COUNT_BYTES(size) ((void) 0)
+#define compareKey(x, y) strcmp((x), (y))
+#endif
+
+extern void printCounters(FILE *);
+extern void resetCounters(void);
+
+#endif
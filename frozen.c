@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frozen.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * frozen.c  - c file for the frozen lookup index
+ *           - written by Ben Lindow
+ *
+ *    inorder(Node *, Node **);
+ *      - collects the nodes of a tree in key order without recursion
+ *      - returns the number of nodes collected
+ *      - usage example: int n = inorder(root, sorted);
+
+ *    place(Frozen *, Node **, int *, unsigned);
+ *      - fills the subtree of slot k from the sorted nodes, left to right
+ *      - each slot's offset is left holding the rank of its node
+ *      - usage example: place(f, sorted, &next, 1);
+
+ *    prefixOf(char *);
+ *      - packs the first eight bytes of a key, zero padded, most significant first
+ *      - returns the packed prefix, which orders the same way strcmp does
+ *      - usage example: uint64_t p = prefixOf(str);
+
+ *    compareSlot(char *, uint64_t, FrozenSlot *, Frozen *);
+ *      - compares a key and its prefix against a slot
+ *      - returns <0, 0 or >0 like strcmp
+ *      - usage example: int c = compareSlot(str, p, slot, f);
+ */
+
+static int inorder(Node *, Node **);
+static void place(Frozen *, Node **, int *, unsigned);
+static uint64_t prefixOf(char *);
+static int compareSlot(char *, uint64_t, FrozenSlot *, Frozen *);
+
+Frozen* freezeTree(Node* root, int size)
+{
+    Frozen* f = allocate(sizeof(Frozen));
+    Node** sorted = allocate((size + 1) * sizeof(Node *));
+    int* offsets = allocate((size + 1) * sizeof(int));
+    void* slots;
+    size_t poolSize = 0;
+    int i, next = 0;
+
+    f->count = inorder(root, sorted);
+    for (i = 0; i < f->count; i++)
+        poolSize += strlen(sorted[i]->data) + 1;
+
+    //Slot 0 is unused, so the four grandchildren of slot k fill one aligned line
+    if (posix_memalign(&slots, 64, (f->count + 1) * sizeof(FrozenSlot)) != 0)
+    {
+        fprintf(stderr,"out of memory");
+        exit(-1);
+    }
+    f->slots = slots;
+    f->pool = allocate(poolSize ? poolSize : 1);
+    poolSize = 0;
+    for (i = 0; i < f->count; i++)
+    {
+        size_t len = strlen(sorted[i]->data) + 1;
+        memcpy(f->pool + poolSize, sorted[i]->data, len);
+        offsets[i] = poolSize;
+        poolSize += len;
+    }
+
+    //Slots come back holding their in-order rank, swap it for the pool offset
+    place(f, sorted, &next, 1);
+    for (i = 1; i <= f->count; i++)
+        f->slots[i].offset = offsets[f->slots[i].offset];
+    free(sorted);
+    free(offsets);
+    return f;
+}
+
+FrozenSlot* findFrozen(char* str, Frozen* f)
+{
+    uint64_t p = prefixOf(str);
+    unsigned n = f->count;
+    unsigned k = 1;
+
+    //Walk to the lower bound, going right whenever the slot is smaller
+    while (k <= n)
+    {
+        __builtin_prefetch(f->slots + 8 * k);
+        __builtin_prefetch(f->slots + 8 * k + 4);
+        k = 2 * k + (compareSlot(str, p, &f->slots[k], f) > 0);
+    }
+    k >>= __builtin_ffs(~k);
+
+    if (k == 0 || compareSlot(str, p, &f->slots[k], f) != 0)
+        return NULL;
+    return &f->slots[k];
+}
+
+char* frozenKey(FrozenSlot* s, Frozen* f)
+{
+    return f->pool + s->offset;
+}
+
+void thawFrozen(Frozen* f)
+{
+    free(f->slots);
+    free(f->pool);
+    free(f);
+}
+
+static int inorder(Node* root, Node** sorted)
+{
+    Node* stack[64];
+    int top = 0, count = 0;
+    Node* n = root;
+
+    while (n || top > 0)
+    {
+        while (n)
+        {
+            stack[top++] = n;
+            n = n->left;
+        }
+        n = stack[--top];
+        sorted[count++] = n;
+        n = n->right;
+    }
+    return count;
+}
+
+static void place(Frozen* f, Node** sorted, int* next, unsigned k)
+{
+    if (k > (unsigned) f->count)
+        return;
+
+    place(f, sorted, next, 2 * k);
+    Node* n = sorted[*next];
+    f->slots[k].prefix = prefixOf(n->data);
+    f->slots[k].freq = n->freq;
+    f->slots[k].offset = (*next)++;
+    place(f, sorted, next, 2 * k + 1);
+}
+
+static uint64_t prefixOf(char* str)
+{
+    uint64_t p = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        p <<= 8;
+        if (*str)
+            p |= (unsigned char) *str++;
+    }
+    return p;
+}
+
+static int compareSlot(char* str, uint64_t p, FrozenSlot* s, Frozen* f)
+{
+    if (p != s->prefix)
+        return p < s->prefix ? -1 : 1;
+    //Equal prefixes that end inside the first eight bytes are equal keys
+    if ((p & 0xff) == 0)
+        return 0;
+    return strcmp(str + 8, f->pool + s->offset + 8);
+}
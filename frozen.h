@@ -0,0 +1,59 @@
+/* VERSION 1.0
+ *
+ * frozen.h  - header file for the frozen lookup index
+ *           - written by Ben Lindow
+ *
+ *    A read-only copy of a tree's keys in Eytzinger (breadth first) order:
+ *    slot k has its children at 2k and 2k+1, so a search is a branch-free
+ *    index walk and the four slots two levels down share one cache line
+ *    that can be prefetched ahead of time.  Each slot keeps the first eight
+ *    bytes of its key as a big-endian integer, so most comparisons never
+ *    leave the array; the rest of the key sits in one shared string pool.
+ *
+ *    freezeTree(Node *, int);
+ *      - builds a frozen index from the in-order keys of a tree with the given node count
+ *      - returns a malloc'd index object
+ *      - usage example: Frozen* f = freezeTree(tree->root, tree->size);
+ *
+ *    findFrozen(char *, Frozen *);
+ *      - looks up a key
+ *      - returns the slot holding the key, else NULL
+ *      - usage example: FrozenSlot* s = findFrozen(str, f);
+ *
+ *    frozenKey(FrozenSlot *, Frozen *);
+ *      - returns the key stored in a slot
+ *      - usage example: char* k = frozenKey(s, f);
+ *
+ *    thawFrozen(Frozen *);
+ *      - frees a frozen index
+ *      - usage example: thawFrozen(f);
+ *
+ */
+
+#ifndef FROZEN_H
+#define FROZEN_H
+
+#include <stdint.h>
+
+#include "node.h"
+
+typedef struct FrozenSlot
+{
+    uint64_t prefix;
+    int freq;
+    int offset;
+} FrozenSlot;
+
+typedef struct Frozen
+{
+    FrozenSlot* slots;
+    int count;
+    char* pool;
+} Frozen;
+
+extern Frozen* freezeTree(Node *, int);
+extern FrozenSlot* findFrozen(char *, Frozen *);
+extern char* frozenKey(FrozenSlot *, Frozen *);
+extern void thawFrozen(Frozen *);
+
+#endif
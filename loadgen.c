@@ -0,0 +1,253 @@
+//  Load generator for the trees daemon
+//
+//  loadgen [SOCKET] [INSTRUCTION FILE] [CLIENTS] [REQUESTS] [PIPELINE DEPTH]
+//
+//  Each client thread connects to the daemon, then repeatedly writes
+//  PIPELINE DEPTH instruction lines (taken round robin from the
+//  instruction file) in a single write and reads until every answer's "."
+//  terminator has arrived.  A request's latency is measured from the write
+//  of its batch to the arrival of its terminator.
+//
+//  Sample Call
+//  -----------
+//
+//  trees -a -D /tmp/trees.sock corpus.txt &
+//  loadgen /tmp/trees.sock instructions.txt 8 100000 16
+//
+/* VERSION 1.0
+ *
+ * loadgen.c - load generator for the tree daemon
+ *           - written by Ben Lindow
+ *
+ *    loadLines(char *);
+ *      - reads the non-blank lines of an instruction file
+ *      - usage example: loadLines(filename);
+ *
+ *    runClient(void *);
+ *      - thread body, drives one connection and records its latencies
+ *      - usage example: pthread_create(&t, NULL, runClient, &client);
+ *
+ *    now(void);
+ *      - monotonic clock in nanoseconds
+ *      - returns the current time
+ *      - usage example: double t = now();
+ *
+ *    compare(const void *, const void *);
+ *      - qsort comparison for latencies
+ *      - usage example: qsort(lat, n, sizeof(double), compare);
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+typedef struct Client
+{
+    pthread_t thread;
+    int id;
+    long requests;
+    double* latency;
+} Client;
+
+//GLOBALS
+char* socketPath;
+char** lines;
+size_t* lengths;
+long lineCount;
+int depth;
+
+void loadLines(char *);
+void* runClient(void *);
+double now(void);
+int compare(const void *, const void *);
+
+int main(int argc, char **argv)
+{
+    if (argc != 6)
+    {
+        fprintf(stderr,"usage: loadgen SOCKET INSTRUCTIONS CLIENTS REQUESTS DEPTH\n");
+        exit(1);
+    }
+
+    socketPath = argv[1];
+    loadLines(argv[2]);
+    int clients = atoi(argv[3]);
+    long requests = atol(argv[4]);
+    depth = atoi(argv[5]);
+    if (clients < 1 || requests < 1 || depth < 1 || lineCount == 0)
+    {
+        fprintf(stderr,"Invalid Arguments\n");
+        exit(1);
+    }
+
+    Client* c = malloc(clients * sizeof(Client));
+    double* all = malloc(clients * requests * sizeof(double));
+    if (!c || !all) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    double start = now();
+    int i;
+    for (i = 0; i < clients; i++)
+    {
+        c[i].id = i;
+        c[i].requests = requests;
+        c[i].latency = all + i * requests;
+        pthread_create(&c[i].thread, NULL, runClient, &c[i]);
+    }
+    for (i = 0; i < clients; i++)
+        pthread_join(c[i].thread, NULL);
+    double elapsed = (now() - start) / 1e9;
+
+    long total = clients * requests;
+    qsort(all, total, sizeof(double), compare);
+    printf("clients %d, depth %d, requests %ld\n", clients, depth, total);
+    printf("throughput: %.0f requests/s\n", total / elapsed);
+    printf("latency p50: %.1f us\n", all[total / 2] / 1e3);
+    printf("latency p99: %.1f us\n", all[(long)(total * 0.99)] / 1e3);
+    printf("latency max: %.1f us\n", all[total - 1] / 1e3);
+    return 0;
+}
+
+void loadLines(char* fname)
+{
+    FILE* fp = fopen(fname, "r");
+    if (!fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+
+    long size = 64;
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    lines = malloc(size * sizeof(char *));
+    lengths = malloc(size * sizeof(size_t));
+
+    while ((len = getline(&line, &cap, fp)) > 0)
+    {
+        if (strspn(line, " \t\r\n") == (size_t) len)
+            continue;
+        if (line[len - 1] != '\n')
+        {
+            line = realloc(line, len + 2);
+            line[len++] = '\n';
+            line[len] = 0;
+        }
+        if (lineCount == size)
+        {
+            size *= 2;
+            lines = realloc(lines, size * sizeof(char *));
+            lengths = realloc(lengths, size * sizeof(size_t));
+        }
+        //A line may hold a NUL, so it is copied by length
+        lines[lineCount] = malloc(len + 1);
+        memcpy(lines[lineCount], line, len + 1);
+        lengths[lineCount++] = len;
+    }
+    free(line);
+    fclose(fp);
+}
+
+void* runClient(void* arg)
+{
+    Client* c = arg;
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        perror("connect");
+        exit(5);
+    }
+
+    size_t outSize = 4096, inSize = 65536;
+    char* out = malloc(outSize);
+    char* in = malloc(inSize);
+    long next = c->id, done = 0;
+
+    while (done < c->requests)
+    {
+        int batch = depth;
+        if (batch > c->requests - done)
+            batch = c->requests - done;
+
+        //Pipeline a whole batch in one write
+        size_t used = 0;
+        int k;
+        for (k = 0; k < batch; k++)
+        {
+            long l = next++ % lineCount;
+            if (used + lengths[l] > outSize)
+                out = realloc(out, outSize = 2 * (used + lengths[l]));
+            memcpy(out + used, lines[l], lengths[l]);
+            used += lengths[l];
+        }
+
+        double sent = now();
+        size_t off = 0;
+        while (off < used)
+        {
+            ssize_t put = write(fd, out + off, used - off);
+            if (put < 0 && errno == EINTR) continue;
+            if (put <= 0) { perror("write"); exit(5); }
+            off += put;
+        }
+
+        //Collect answers, a line holding "." ends each one
+        int answered = 0, atLineStart = 1, dot = 0;
+        while (answered < batch)
+        {
+            ssize_t got = read(fd, in, inSize);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) { fprintf(stderr,"daemon hung up\n"); exit(5); }
+
+            ssize_t j;
+            for (j = 0; j < got; j++)
+            {
+                if (in[j] == '\n')
+                {
+                    if (dot)
+                        c->latency[done + answered++] = now() - sent;
+                    atLineStart = 1;
+                    dot = 0;
+                }
+                else
+                {
+                    dot = atLineStart && in[j] == '.';
+                    atLineStart = 0;
+                }
+            }
+        }
+        done += batch;
+    }
+
+    close(fd);
+    free(out);
+    free(in);
+    return NULL;
+}
+
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int compare(const void* x, const void* y)
+{
+    double a = *(const double *) x, b = *(const double *) y;
+    return (a > b) - (a < b);
+}
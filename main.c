@@ -13,13 +13,49 @@
 //  -----------------
 //                                                          |
 //  tree [TREE TYPE] [CORPUS FILE] [INSTRUCTION FILE]       |
+//  tree [TREE TYPE] -D [SOCKET] [CORPUS FILE]              |
+//  tree [TREE TYPE] -c [CORPUS FILE] [INSTRUCTION FILE]    |
+//  tree [TREE TYPE] -t [CORPUS FILE] [INSTRUCTION FILE]    |
+//  tree -b -w [CORPUS FILE] [INSTRUCTION FILE]             |
+//  tree [TREE TYPE] -f [CORPUS FILE] [INSTRUCTION FILE]    |
+//  tree [TREE TYPE] -m [CORPUS FILE] [INSTRUCTION FILE]    |
+//                               [QUERY FILE]...            |
+//  tree [TREE TYPE] -j [THREADS] [CORPUS FILE]             |
+//                               [INSTRUCTION FILE]         |
+//  tree -a -k [SHARDS] [CORPUS FILE] [INSTRUCTION FILE]    |
+//  tree -a -e [MEGABYTES] [CORPUS FILE]                    |
+//                               [INSTRUCTION FILE]         |
+//  tree -a -e [MEGABYTES] -o [COUNT FILE] [CORPUS FILE]    |
+//  tree -a -l [PERCENT] [CORPUS FILE] [INSTRUCTION FILE]   |
+//  tree -a -r [CORPUS FILE] [INSTRUCTION FILE]             |
+//  tree -a -n [CORPUS FILE] [INSTRUCTION FILE]             |
+//  tree [TREE TYPE] -g [CORPUS FILE]... [INSTRUCTION FILE] |
 //                                                          |
 //  [TREE TYPE] = "-a" -> AVL Tree Construction             |
 //              = "-b" -> BST Tree Construction             |
+//              = "-p" -> Persistent AVL Tree Construction  |
+//              = "-d" -> Packed Dictionary, in place of    |
+//                        the corpus file, f, l and r only  |
 //                                                          |
 //  [CORUPUS FILE] = "words.txt"                            |
+//                  = a directory -> every file in it, in   |
+//                    name order                            |
+//                  = several, with -g -> read at once on   |
+//                    worker threads, same tree as reading  |
+//                    them one after another                |
 //                                                          |
 //  [INSTRUCTION FILE] = "instructions.txt"                 |
+//                     = "-" or a FIFO -> streaming mode    |
+//                                                          |
+//  [QUERY FILE] = "queries.txt", only f, r and s, each     |
+//                 run on its own thread alongside the      |
+//                 instruction file (-m, AVL and BST only)  |
+//                                                          |
+//  -n = named trees: every instruction names its tree      |
+//       first ("i tenant1 word"), trees are made the first |
+//       time they are named and share one node arena, the  |
+//       corpus builds the tree named "main", and "r *"     |
+//       reports on every tree at once                      |
 //                                                          |
 //  *********************************************************
 //                                                          |
@@ -29,6 +65,19 @@
 //                                                          |
 //  tree -a avltext.txt avlinstructions.txt                 |
 //  tree -b bsttext.txt bstinstructions.txt                 |
+//  tree -a -D /tmp/trees.sock avltext.txt                  |
+//  tree -b -w bsttext.txt bstinstructions.txt              |
+//  tree -a -m avltext.txt updates.txt q1.txt q2.txt        |
+//  tree -a -j 4 avltext.txt avlinstructions.txt            |
+//  tree -a -k 16 avltext.txt avlinstructions.txt           |
+//  tree -a -e 64 avltext.txt avlinstructions.txt           |
+//  tree -a -e 64 -o counts.bin avltext.txt                 |
+//  tree -d words.dict dictinstructions.txt                 |
+//  tree -a -l 25 avltext.txt avlinstructions.txt           |
+//  tree -a -r avltext.txt avlinstructions.txt              |
+//  tree -a -n avltext.txt namedinstructions.txt            |
+//  tree -a -g part1.txt part2.txt avlinstructions.txt      |
+//  tree -b shards/ bstinstructions.txt                     |
 //                                                          |
 //  *********************************************************
 //                                                          |
@@ -40,6 +89,11 @@
 //  f = report frequency of word                            |
 //  r = report statistics of tree                           |
 //  s = show tree                                           |
+//  m = merge corpus file into tree (AVL only)              |
+//  x = delete every word from one word to another (AVL)    |
+//  l = list every word from one word to another            |
+//  w = write tree to a packed dictionary file (AVL, BST)   |
+//  c = report and reset counters (build with COUNTERS=1)   |
 //                                                          |
 //  ---------------------------------------------------------
 //
@@ -58,10 +112,33 @@
  *      - builds AVL with keys from filename
  *      - usage example: buildAVL(filename)
  *
+ *    buildExternal(char *);
+ *      - counts the words of filename within the -e budget into a sorted count
+ *      - file, then bulk builds the AVL from it, or with -o only writes the file
+ *      - usage example: buildExternal(filename)
+ *
  *    buildBST(char *);
  *      - builds BST with keys from filename
  *      - usage example: buildBST(filename);
  *
+ *    addCorpus(char *)
+ *      - checks a corpus file and adds it to the list, or every regular file of a
+ *      - directory in name order
+ *      - usage example: addCorpus(argv[i]);
+ *
+ *    compareNames(const void *, const void *)
+ *      - qsort comparison for an array of file names
+ *      - usage example: qsort(names, n, sizeof(char *), compareNames);
+ *
+ *    buildCorpora(void (*)(char *, int))
+ *      - tokenizes the listed corpus files on worker threads and adds each file's
+ *      - words, in order, to the tree
+ *      - usage example: buildCorpora(addAVL)
+ *
+ *    addAVL(char *, int), addBST(char *, int), addPAVL(char *, int)
+ *      - adds a word, with how often it appeared, to the tree
+ *      - usage example: addAVL(str, count)
+ *
  *    runAVLInstructions(char *)
  *      - runs AVL instructions from filename
  *      - usage example: runAVLInstructions(filename)
@@ -70,6 +147,118 @@
  *      - runs BST instructions from filename
  *      - usage example: runBSTInstructions(filename)
  *
+ *    execBST(char, FILE *), execAVL(char, FILE *), execPAVL(char, FILE *)
+ *      - runs a single instruction, reading its argument from the stream
+ *      - usage example: execAVL(instruction, fp)
+ *
+ *    applyBST(char, char *), applyAVL(char, char *), applyPAVL(char, char *)
+ *      - runs a single instruction whose key has already been read
+ *      - usage example: applyAVL('i', str)
+ *
+ *    runPackedInstructions(char *), execPacked(char, FILE *), applyPacked(char, char *)
+ *      - as for AVL, against a packed dictionary, which only answers f, l and r
+ *      - usage example: runPackedInstructions(filename)
+ *
+ *    runShardedInstructions(char *), execSharded(char, FILE *), applySharded(char, char *)
+ *      - as for AVL, each key going to the shard that holds its range
+ *      - usage example: runShardedInstructions(filename)
+ *
+ *    runNamedInstructions(char *), execNamed(char, FILE *)
+ *      - as for AVL, each instruction first reading the name of the tree it runs on
+ *      - usage example: runNamedInstructions(filename)
+ *
+ *    treeNamed(char *)
+ *      - finds a named tree, making an empty one on the shared arena the first time
+ *      - returns the tree
+ *      - usage example: a = treeNamed("main");
+ *
+ *    printStatsNamed(void)
+ *      - prints the statistics of every named tree together, then of each one
+ *      - and of the arena they share
+ *      - usage example: printStatsNamed();
+ *
+ *    newNode(char *)
+ *      - makes a node from the arena with -n, else with createNode
+ *      - returns the node, whose data is not str if the string can be freed
+ *      - usage example: Node* n = newNode(str);
+ *
+ *    queryBST(char, char *, FILE *), queryAVL(char, char *, FILE *)
+ *      - runs a single f, r or s without touching the tree, writing to out
+ *      - safe on many threads at once while no instruction changes the tree
+ *      - usage example: queryAVL('f', str, out)
+ *
+ *    readKey(char, FILE *)
+ *      - reads the argument an instruction is followed by, a trimmed key for i, d
+ *      - and f, an untrimmed file name for m and w, and for x and l both trimmed keys
+ *      - in one string, the second after the first's terminator
+ *      - returns the argument, NULL if the instruction takes none
+ *      - usage example: char* key = readKey(instruction, fp);
+ *
+ *    mergeAVL(char *)
+ *      - builds a second AVL from a corpus file and unions it into the tree
+ *      - usage example: mergeAVL(filename)
+ *
+ *    pipeFile(char *, int, void (*)(char, char *))
+ *      - tokenizes a corpus (0) or instruction file (1) on a reader thread
+ *      - and applies each token from the ring on this thread
+ *      - usage example: pipeFile(filename, 0, applyAVL)
+ *
+ *    streamInstructions(int, void (*)(char, FILE *))
+ *      - runs instructions from a pipe one line at a time as they arrive
+ *      - output is flushed each time the pipe has no more complete lines ready
+ *      - usage example: streamInstructions(STDIN_FILENO, execAVL)
+ *
+ *    streamFd(char *)
+ *      - opens the streaming instruction source, "-" is stdin
+ *      - returns a file descriptor
+ *      - usage example: int fd = streamFd(fname);
+ *
+ *    runLine(char *, size_t, void (*)(char, FILE *))
+ *      - runs every instruction found in one buffered line
+ *      - usage example: runLine(line, len, execAVL)
+ *
+ *    buildPAVL(char *);
+ *      - builds persistent AVL with keys from filename
+ *      - usage example: buildPAVL(filename);
+ *
+ *    runPAVLInstructions(char *)
+ *      - runs persistent AVL instructions from filename, s and r render a
+ *      - frozen version on a reader thread while later instructions run
+ *      - usage example: runPAVLInstructions(filename)
+ *
+ *    runProgram(char *)
+ *      - compiles the instruction file to opcodes, then runs them against the tree
+ *      - reports parse and execution times on stderr
+ *      - usage example: runProgram(filename)
+ *
+ *    runParallel(char *, void (*)(char, char *), void (*)(char, char *, FILE *), FILE *)
+ *      - runs an instruction file, fanning each run of consecutive f, r and s
+ *      - out over the thread pool; output is the same as a serial run
+ *      - usage example: runParallel(filename, applyAVL, queryAVL, a->out)
+ *
+ *    flushRun(Run *, FILE *)
+ *      - runs the held read-only instructions in chunks, one per pool task, and
+ *      - writes each chunk's output in order
+ *      - usage example: flushRun(&run, out)
+ *
+ *    runChunk(int, void *)
+ *      - pool task that runs one chunk of a read-only run into its own buffer
+ *      - usage example: runPool(pool, runChunk, run.chunks, &run)
+ *
+ *    seconds(void)
+ *      - monotonic clock
+ *      - returns the current time in seconds
+ *      - usage example: double t = seconds();
+ *
+ *    startReader(char);
+ *      - snapshots the persistent AVL and starts a reader thread for s or r
+ *      - output produced by the writer meanwhile is held back in a buffer
+ *      - usage example: startReader('s');
+ *
+ *    joinReader(void);
+ *      - waits for the reader thread and writes its output, then the held back output
+ *      - usage example: joinReader();
+ *
  *    readStream(FILE *);
  *      - reads a token using scanner.c
  *      - returns either a string of either one word or multiple words in quotes
@@ -82,30 +271,153 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
 
 #include "node.h"
 #include "scanner.h"
 #include "bst.h"
 #include "queue.h"
 #include "avl.h"
+#include "pavl.h"
+#include "server.h"
+#include "program.h"
+#include "ring.h"
+#include "shared.h"
+#include "pool.h"
+#include "sharded.h"
+#include "spill.h"
+#include "packed.h"
+#include "arena.h"
+#include "corpus.h"
+#include "counters.h"
+
+#define RUN_LIMIT 4096
+#define CHUNK_MIN 16
+
+typedef struct Run
+{
+    char ops[RUN_LIMIT];
+    char* keys[RUN_LIMIT];
+    int count;
+    int chunks;
+    char* bufs[RUN_LIMIT / CHUNK_MIN];
+    size_t lens[RUN_LIMIT / CHUNK_MIN];
+    void (*query)(char, char *, FILE *);
+} Run;
+
+typedef struct Reader
+{
+    pthread_t thread;
+    PAVL* snap;
+    char op;
+    int busy;
+    char* buf;
+    size_t len;
+    char* held;
+    size_t hlen;
+    FILE* dest;
+} Reader;
+
+typedef struct Named
+{
+    char* name;
+    AVL* tree;
+} Named;
 
 //GLOBALS
 BST* b;
 AVL* a;
+PAVL* p;
+Sharded* k;
+Packed* z;
+Reader reader;
 FILE* fp;
 char treeType;
 char* fname1;
 char* fname2;
+int streaming;
+char* socketPath;
+int compiled;
+int threaded;
+int weighted;
+int filtered;
+int multi;
+char** queryFiles;
+int queryCount;
+int jobs;
+Pool* pool;
+int shards;
+long budget;
+int lazy;
+int relaxed;
+char* snapshot;
+int namespaced;
+Named* names;
+int nameCount;
+Arena* arena;
+int gathered;
+char** corpora;
+int corpusCount;
 
 void validateOptions(int, char **);
 void buildAVL(char *);
+void buildExternal(char *);
 void buildBST(char *);
+void addCorpus(char *);
+int compareNames(const void *, const void *);
+void buildCorpora(void (*)(char *, int));
+void addAVL(char *, int);
+void addBST(char *, int);
+void addPAVL(char *, int);
 void runAVLInstructions(char *);
 void runBSTInstructions(char *);
+void buildPAVL(char *);
+void runPAVLInstructions(char *);
+void execBST(char, FILE *);
+void execAVL(char, FILE *);
+void execPAVL(char, FILE *);
+void applyBST(char, char *);
+void applyAVL(char, char *);
+void applyPAVL(char, char *);
+void runPackedInstructions(char *);
+void execPacked(char, FILE *);
+void applyPacked(char, char *);
+void runShardedInstructions(char *);
+void execSharded(char, FILE *);
+void applySharded(char, char *);
+void runNamedInstructions(char *);
+void execNamed(char, FILE *);
+AVL* treeNamed(char *);
+void printStatsNamed(void);
+Node* newNode(char *);
+void queryBST(char, char *, FILE *);
+void queryAVL(char, char *, FILE *);
+char* readKey(char, FILE *);
+void mergeAVL(char *);
+void pipeFile(char *, int, void (*)(char, char *));
+void streamInstructions(int, void (*)(char, FILE *));
+void runLine(char *, size_t, void (*)(char, FILE *));
+int streamFd(char *);
+void runProgram(char *);
+void runParallel(char *, void (*)(char, char *), void (*)(char, char *, FILE *), FILE *);
+void flushRun(Run *, FILE *);
+void runChunk(int, void *);
+double seconds(void);
+void startReader(char);
+void joinReader(void);
+void* readSnapshot(void *);
 char* readStream(FILE*);
 void trim(char*);
 
@@ -113,17 +425,100 @@ int main(int argc,char **argv)
 {
     validateOptions(argc, argv);
     
-    if(argv[1][1] == 'b')
+    if(treeType == 'b')
     {
         b = initBST();
         buildBST(fname1);
-        runBSTInstructions(fname2);
+        if(weighted)
+            reweighBST(b);
+        if(filtered)
+            filterBST(b);
+        if(socketPath)
+            serveTree(socketPath, execBST, &b->out, NULL);
+        else if(multi)
+            runStreams(fname2, queryFiles, queryCount, applyBST, queryBST, &b->out, readKey);
+        else if(jobs)
+            runParallel(fname2, applyBST, queryBST, b->out);
+        else if(streaming)
+            streamInstructions(streamFd(fname2), execBST);
+        else if(compiled)
+            runProgram(fname2);
+        else
+            runBSTInstructions(fname2);
+    }
+    else if(treeType == 'p')
+    {
+        p = initPAVL();
+        buildPAVL(fname1);
+        if(socketPath)
+            serveTree(socketPath, execPAVL, &p->out, joinReader);
+        else if(streaming)
+            streamInstructions(streamFd(fname2), execPAVL);
+        else if(compiled)
+            runProgram(fname2);
+        else
+            runPAVLInstructions(fname2);
+    }
+    else if(treeType == 'd')
+    {
+        z = openPacked(fname1);
+        if(!z)
+        {
+            fprintf(stderr, errno == EINVAL ? "Corrupt Dictionary File\n" : "Invalid File Name\n");
+            exit(3);
+        }
+        if(streaming)
+            streamInstructions(streamFd(fname2), execPacked);
+        else
+            runPackedInstructions(fname2);
+    }
+    else if(shards)
+    {
+        k = initSharded(shards);
+        buildSharded(fname1, sysconf(_SC_NPROCESSORS_ONLN), readStream, k);
+        if(streaming)
+            streamInstructions(streamFd(fname2), execSharded);
+        else
+            runShardedInstructions(fname2);
     }
     else
     {
-        a = initAVL();
-        buildAVL(fname1);
-        runAVLInstructions(fname2);
+        if(namespaced)
+            arena = initArena();
+        a = namespaced ? treeNamed("main") : initAVL();
+        a->lazy = lazy;
+        a->relaxed = relaxed;
+        if(budget)
+            buildExternal(fname1);
+        else
+            buildAVL(fname1);
+        //Instructions may read the tree at any point, so they insert eagerly
+        settleAVL(a);
+        a->relaxed = 0;
+        if(snapshot)
+            return 0;
+        if(filtered)
+            filterAVL(a);
+        if(socketPath)
+            serveTree(socketPath, execAVL, &a->out, NULL);
+        else if(multi)
+            runStreams(fname2, queryFiles, queryCount, applyAVL, queryAVL, &a->out, readKey);
+        else if(jobs)
+            runParallel(fname2, applyAVL, queryAVL, a->out);
+        else if(streaming)
+            streamInstructions(streamFd(fname2), namespaced ? execNamed : execAVL);
+        else if(compiled)
+            runProgram(fname2);
+        else if(namespaced)
+            runNamedInstructions(fname2);
+        else
+            runAVLInstructions(fname2);
+    }
+
+    if(filtered)
+    {
+        fflush(stdout);
+        reportBloom(treeType == 'b' ? b->filter : a->filter, stderr);
     }
 
     return 0;
@@ -131,50 +526,275 @@ int main(int argc,char **argv)
 
 void validateOptions(int argc, char **argv)
 {
-    //Too Many/Few Arguments
-    if (argc != 4)
+    int i = 2;
+
+    //Too Few Arguments
+    if (argc < 3)
     {
         fprintf(stderr,"Invalid Number of Arguments\n");
         exit(1);
     }
     //Checks Dash Options
-    if(argv[1][1] != 'b' && argv[1][1] != 'a')
+    if(argv[1][1] != 'b' && argv[1][1] != 'a' && argv[1][1] != 'p' && argv[1][1] != 'd')
     {
         fprintf(stderr,"Invalid Dash Option\n");
         exit(2);
     }
-    //Checks First Filename
-    fp = fopen(argv[2], "r");
-    if (!fp)
+    treeType = argv[1][1];
+    //Checks Mode Options
+    while (i < argc && argv[i][0] == '-' && argv[i][1])
     {
-        fprintf(stderr,"Invalid File Name\n");
-        exit(3);
+        switch (argv[i][1])
+        {
+            case 'D':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                socketPath = argv[i];
+                break;
+            case 'c':
+                compiled = 1;
+                break;
+            case 't':
+                threaded = 1;
+                break;
+            case 'w':
+                weighted = 1;
+                break;
+            case 'f':
+                filtered = 1;
+                break;
+            case 'm':
+                multi = 1;
+                break;
+            case 'j':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                jobs = atoi(argv[i]);
+                if (jobs < 1)
+                {
+                    fprintf(stderr,"Invalid Dash Option\n");
+                    exit(2);
+                }
+                break;
+            case 'k':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                shards = atoi(argv[i]);
+                if (shards < 1)
+                {
+                    fprintf(stderr,"Invalid Dash Option\n");
+                    exit(2);
+                }
+                break;
+            case 'e':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                budget = atol(argv[i]) << 20;
+                if (budget < 1)
+                {
+                    fprintf(stderr,"Invalid Dash Option\n");
+                    exit(2);
+                }
+                break;
+            case 'l':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                lazy = atoi(argv[i]);
+                if (lazy < 1 || lazy > 100)
+                {
+                    fprintf(stderr,"Invalid Dash Option\n");
+                    exit(2);
+                }
+                break;
+            case 'r':
+                relaxed = 1;
+                break;
+            case 'n':
+                namespaced = 1;
+                break;
+            case 'g':
+                gathered = 1;
+                break;
+            case 'o':
+                if (++i == argc)
+                {
+                    fprintf(stderr,"Invalid Number of Arguments\n");
+                    exit(1);
+                }
+                snapshot = argv[i];
+                break;
+            default:
+                fprintf(stderr,"Invalid Dash Option\n");
+                exit(2);
+        }
+        i++;
     }
-    fclose(fp);
-    //Checks Second Filename
-    fopen(argv[3], "r");
-    if (!fp)
+    //Persistent versions share nodes, so there is no single tree to filter
+    if (filtered && treeType == 'p')
     {
-        fprintf(stderr,"Invalid File Name\n");
-        exit(4);
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
     }
-    fclose(fp);
+    //Only the plain BST keeps a weight-balanced shape, AVL rotations would undo it
+    if (weighted && treeType != 'b')
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Query streams share one tree, which persistent versions never have to
+    if ((multi || jobs) && (treeType == 'p' || socketPath || compiled || threaded || (multi && jobs)))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Shards are AVL trees built on their own pool, so no other mode applies
+    if (shards && (treeType != 'a' || socketPath || compiled || threaded || weighted || filtered || multi || jobs))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //A dictionary is only read, one instruction at a time
+    if (treeType == 'd' && (socketPath || compiled || threaded || weighted || filtered || multi || jobs || shards || budget))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Tombstones and relaxed balance are only kept by AVL trees
+    if ((lazy || relaxed) && (treeType != 'a' || shards))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Named trees are plain AVL trees run one instruction at a time on one thread
+    if (namespaced && (treeType != 'a' || socketPath || compiled || threaded || filtered || multi || jobs || shards))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //The bulk builder makes AVL trees from a single counted pass
+    if (budget && (treeType != 'a' || threaded || shards))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //A count file is all -o makes, so there is no tree to run anything on
+    if (snapshot && (!budget || socketPath || compiled || filtered || multi || jobs))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Query files follow the instruction file, so they cannot follow a list of corpora
+    if (gathered && multi)
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    //Too Many/Few Arguments, a daemon or count file takes no instruction file
+    int files = socketPath || snapshot ? 1 : 2;
+    if (gathered ? argc - i < files : multi ? argc - i < 2 : argc - i != files)
+    {
+        fprintf(stderr,"Invalid Number of Arguments\n");
+        exit(1);
+    }
+    //Checks First Filename, or every one with -g; a directory stands for its files
+    struct stat st;
+    fname1 = argv[i];
+    if (!gathered && stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+        gathered = 1;
+    if (gathered)
+    {
+        while (i <= argc - files)
+            addCorpus(argv[i++]);
+    }
+    else
+    {
+        fp = fopen(argv[i], "r");
+        if (!fp)
+        {
+            fprintf(stderr,"Invalid File Name\n");
+            exit(3);
+        }
+        fclose(fp);
+        i++;
+    }
+    //Several corpora are read by their own workers, which only the plain builds take
+    if (gathered && (threaded || budget || shards || treeType == 'd'))
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+    if (socketPath || snapshot) {return;}
 
-    treeType = argv[1][1];
-    fname1 = argv[2];
-    fname2 = argv[3];
+    //Checks Second Filename, opening a FIFO here would hang up its writer
+    if (strcmp(argv[i], "-") == 0)
+        streaming = 1;
+    else if (stat(argv[i], &st) == 0 && S_ISFIFO(st.st_mode))
+        streaming = 1;
+    else
+    {
+        fp = fopen(argv[i], "r");
+        if (!fp)
+        {
+            fprintf(stderr,"Invalid File Name\n");
+            exit(4);
+        }
+        fclose(fp);
+    }
+    fname2 = argv[i];
+
+    //A program is compiled from the whole file, so it cannot stream
+    if ((compiled || multi || jobs) && streaming)
+    {
+        fprintf(stderr,"Invalid Dash Option\n");
+        exit(2);
+    }
+
+    //Checks Query Filenames
+    queryFiles = argv + i + 1;
+    queryCount = argc - i - 1;
+    for (i = 0; i < queryCount; i++)
+    {
+        fp = fopen(queryFiles[i], "r");
+        if (!fp)
+        {
+            fprintf(stderr,"Invalid File Name\n");
+            exit(4);
+        }
+        fclose(fp);
+    }
 }
 
 void buildAVL(char* fname)
 {
+    if(threaded) { pipeFile(fname, 0, applyAVL); return; }
+    if(gathered) { buildCorpora(addAVL); return; }
+
     fp = fopen(fname, "r");
     char *str = readStream(fp);
     Node* n;
     
     while(!feof(fp))
     {
-        n = createNode(str);
-        if(strcmp(str, "") != 0)
+        n = newNode(str);
+        //An inlined key no longer needs the string
+        if(n->data != str)
+            free(str);
+        if(strcmp(n->data, "") != 0)
             insertAVL(n, a);
         str = readStream(fp);
     }
@@ -182,8 +802,75 @@ void buildAVL(char* fname)
     fclose(fp);
 }
 
+void mergeAVL(char* fname)
+{
+    FILE* in = fopen(fname, "r");
+    AVL* t;
+    Node* n;
+
+    if (!in)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        return;
+    }
+
+    t = initAVL();
+    t->arena = arena;
+    char *str = readStream(in);
+    while(!feof(in))
+    {
+        n = newNode(str);
+        if(n->data != str)
+            free(str);
+        if(strcmp(n->data, "") != 0)
+            insertAVL(n, t);
+        str = readStream(in);
+    }
+    fclose(in);
+
+    unionAVL(a, t, sysconf(_SC_NPROCESSORS_ONLN));
+    free(t->hot);
+    free(t);
+}
+
+void buildExternal(char* fname)
+{
+    FILE* counts = snapshot ? fopen(snapshot, "w+") : tmpfile();
+    Node** nodes;
+    Node* n;
+    char* key;
+    int freq;
+    long i;
+
+    if (!counts)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    long count = countExternal(fname, budget, readStream, counts);
+    if (snapshot) { fclose(counts); return; }
+
+    //The count file is in key order, so the nodes come out sorted
+    nodes = allocate(count * sizeof(Node *));
+    for (i = 0; i < count && (key = readCount(counts, &freq)); i++)
+    {
+        n = newNode(key);
+        if(n->data != key)
+            free(key);
+        n->freq = freq;
+        nodes[i] = n;
+    }
+    fclose(counts);
+
+    bulkAVL(nodes, i, sysconf(_SC_NPROCESSORS_ONLN), a);
+    free(nodes);
+}
+
 void buildBST(char* fname)
 {
+    if(threaded) { pipeFile(fname, 0, applyBST); return; }
+    if(gathered) { buildCorpora(addBST); return; }
+
     fp = fopen(fname, "r");
     char *str = readStream(fp);
     Node* n;
@@ -191,7 +878,10 @@ void buildBST(char* fname)
     while(!feof(fp))
     {
         n = createNode(str);
-        if(strcmp(str, "") != 0)
+        //An inlined key no longer needs the string
+        if(n->data != str)
+            free(str);
+        if(strcmp(n->data, "") != 0)
             insert(n, b);
         str = readStream(fp);
     }
@@ -199,76 +889,853 @@ void buildBST(char* fname)
     fclose(fp);
 }
 
+void addCorpus(char* path)
+{
+    struct stat st;
+    struct dirent* entry;
+    DIR* dir;
+    char* file;
+    int first = corpusCount;
+
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        dir = opendir(path);
+        if (!dir)
+        {
+            fprintf(stderr,"Invalid File Name\n");
+            exit(3);
+        }
+        while ((entry = readdir(dir)))
+        {
+            file = allocate(strlen(path) + strlen(entry->d_name) + 2);
+            sprintf(file, "%s/%s", path, entry->d_name);
+            if (stat(file, &st) == 0 && S_ISREG(st.st_mode))
+            {
+                corpora = reallocate(corpora, (corpusCount + 1) * sizeof(char *));
+                corpora[corpusCount++] = file;
+            }
+            else
+                free(file);
+        }
+        closedir(dir);
+        //readdir's order is the file system's, so sort for a tree that is the same every run
+        qsort(corpora + first, corpusCount - first, sizeof(char *), compareNames);
+        return;
+    }
+
+    fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    fclose(fp);
+    corpora = reallocate(corpora, (corpusCount + 1) * sizeof(char *));
+    corpora[corpusCount++] = path;
+}
+
+int compareNames(const void* x, const void* y)
+{
+    return strcmp(*(char * const *) x, *(char * const *) y);
+}
+
+void buildCorpora(void (*add)(char *, int))
+{
+    Corpus* c;
+    Words* w;
+    int i;
+
+    if (corpusCount == 0)
+        return;
+    c = startCorpus(corpora, corpusCount, sysconf(_SC_NPROCESSORS_ONLN), readStream);
+    while ((w = nextFile(c)))
+    {
+        for (i = 0; i < w->count; i++)
+            add(w->keys[i], w->counts[i]);
+        doneFile(c);
+    }
+}
+
+void addAVL(char* key, int count)
+{
+    Node* n = newNode(key);
+
+    if(n->data != key)
+        free(key);
+    n->freq = count;
+    insertAVL(n, a);
+}
+
+void addBST(char* key, int count)
+{
+    Node* n = createNode(key);
+
+    if(n->data != key)
+        free(key);
+    n->freq = count;
+    insert(n, b);
+}
+
+void addPAVL(char* key, int count)
+{
+    while (count--)
+        insertPAVL(key, p);
+    free(key);
+}
+
 void runBSTInstructions(char* fname)
+{
+    if(threaded) { pipeFile(fname, 1, applyBST); return; }
+
+    fp = fopen(fname, "r");
+    char instruction = readChar(fp);
+
+    while(!feof(fp))
+    {
+        execBST(instruction, fp);
+        instruction = readChar(fp);
+    }
+}
+
+void execBST(char instruction, FILE* fp)
+{
+    applyBST(instruction, readKey(instruction, fp));
+}
+
+void applyBST(char instruction, char* key)
+{
+    Node *n;
+
+    //The ring and query streams only read keys for i, d and f
+    if (!key && (instruction == 'l' || instruction == 'w'))
+    {
+        fprintf(stderr,"Invalid Instruction\n");
+        exit(4);
+    }
+
+    switch (instruction)
+    {
+        case 'i':
+            n = createNode(key);
+            if(n->data != key)
+                free(key);
+            insert(n, b);
+            break;
+        case 'd':
+            n = createNode(key);
+            deleet(n, b);
+            break;
+        case 'f':
+            n = createNode(key);
+            printFreq(n, b);
+            break;
+        case 's':
+            printTree(b);
+            break;
+        case 'r':
+            printStats(b);
+            break;
+        case 'l':
+            showRange(key, key + strlen(key) + 1, b->out, b);
+            free(key);
+            break;
+        case 'c':
+            printCounters(b->out);
+            resetCounters();
+            break;
+        case 'w':
+            if (writePacked(b->root, key) < 0)
+                fprintf(stderr,"Invalid File Name\n");
+            free(key);
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+}
+
+void runPackedInstructions(char* fname)
+{
+    fp = fopen(fname, "r");
+    char instruction = readChar(fp);
+
+    while(!feof(fp))
+    {
+        execPacked(instruction, fp);
+        instruction = readChar(fp);
+    }
+}
+
+void execPacked(char instruction, FILE* fp)
+{
+    applyPacked(instruction, readKey(instruction, fp));
+}
+
+void applyPacked(char instruction, char* key)
+{
+    switch (instruction)
+    {
+        case 'f':
+            printFreqPacked(key, z);
+            break;
+        case 'l':
+            printRangePacked(key, key + strlen(key) + 1, z);
+            break;
+        case 'r':
+            printStatsPacked(z);
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+    free(key);
+}
+
+void runShardedInstructions(char* fname)
 {
     fp = fopen(fname, "r");
     char instruction = readChar(fp);
+
+    while(!feof(fp))
+    {
+        execSharded(instruction, fp);
+        instruction = readChar(fp);
+    }
+}
+
+void execSharded(char instruction, FILE* fp)
+{
+    applySharded(instruction, readKey(instruction, fp));
+}
+
+void applySharded(char instruction, char* key)
+{
     Node *n;
 
+    switch (instruction)
+    {
+        case 'i':
+            n = createNode(key);
+            if(n->data != key)
+                free(key);
+            insertAVL(n, shardOf(n->data, k));
+            break;
+        case 'd':
+            n = createNode(key);
+            deleetSharded(n, k);
+            break;
+        case 'x':
+            deleetRangeSharded(key, key + strlen(key) + 1, k);
+            free(key);
+            break;
+        case 'f':
+            n = createNode(key);
+            printFreqSharded(n, k);
+            break;
+        case 's':
+            printTreeSharded(k);
+            break;
+        case 'r':
+            printStatsSharded(k);
+            break;
+        case 'l':
+            printRangeSharded(key, key + strlen(key) + 1, k);
+            free(key);
+            break;
+        case 'c':
+            printCounters(k->out);
+            resetCounters();
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+}
+
+void runNamedInstructions(char* fname)
+{
+    fp = fopen(fname, "r");
+    char instruction = readChar(fp);
+
     while(!feof(fp))
     {
-        switch (instruction)
+        execNamed(instruction, fp);
+        instruction = readChar(fp);
+    }
+}
+
+void execNamed(char instruction, FILE* fp)
+{
+    //A name keeps its case, digits and punctuation, like a file name
+    char* name = stringPending(fp) ? readString(fp) : readToken(fp);
+
+    if (!name)
+    {
+        fprintf(stderr,"Invalid Instruction\n");
+        exit(4);
+    }
+    if (strcmp(name, "*") == 0)
+    {
+        if (instruction == 'c')
         {
-            case 'i':
-                n = createNode(readStream(fp));
-                insert(n, b);
-                break;
-            case 'd':
-                n = createNode(readStream(fp));
-                deleet(n, b);
-                break;
-            case 'f':
-                n = createNode(readStream(fp));
-                printFreq(n, b);
-                break;
-            case 's':
-                printTree(b);
-                break;
-            case 'r':
-                printStats(b);
-                break;
-            default:
-                fprintf(stderr,"Invalid Instruction\n");
-                exit(4);
+            printCounters(stdout);
+            resetCounters();
         }
-        instruction = readChar(fp);
+        else if (instruction != 'r')
+        {
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+        }
+        else
+            printStatsNamed();
+    }
+    else
+    {
+        a = treeNamed(name);
+        applyAVL(instruction, readKey(instruction, fp));
+    }
+    free(name);
+}
+
+AVL* treeNamed(char* name)
+{
+    int lo = 0, hi = nameCount - 1, mid, c;
+
+    while (lo <= hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        c = strcmp(name, names[mid].name);
+        if (c == 0)
+            return names[mid].tree;
+        if (c < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+
+    //Kept in name order, so "r *" lists the trees sorted
+    names = reallocate(names, (nameCount + 1) * sizeof(Named));
+    memmove(names + lo + 1, names + lo, (nameCount - lo) * sizeof(Named));
+    names[lo].name = allocate(strlen(name) + 1);
+    strcpy(names[lo].name, name);
+    names[lo].tree = initAVL();
+    names[lo].tree->arena = arena;
+    names[lo].tree->lazy = lazy;
+    nameCount++;
+    return names[lo].tree;
+}
+
+void printStatsNamed(void)
+{
+    Stats* st = allocate(nameCount * sizeof(Stats));
+    long long weight = 0;
+    double sum = 0;
+    long size = 0;
+    int min = -1, height = 0;
+    int i;
+
+    for (i = 0; i < nameCount; i++)
+    {
+        compactAVL(names[i].tree);
+        statsAVL(names[i].tree, &st[i]);
+        if (st[i].min == -1)
+            continue;
+        size += names[i].tree->size;
+        weight += st[i].weight;
+        sum += st[i].depth * st[i].weight;
+        if (min == -1 || st[i].min < min)
+            min = st[i].min;
+        if (st[i].height > height)
+            height = st[i].height;
+    }
+
+    if (min == -1)
+        fprintf(stdout, "Empty Tree!\n");
+    else
+    {
+        fprintf(stdout, "\nNumber of Nodes in All Trees: %ld\n", size);
+        fprintf(stdout, "Distance to Closest Null Child: %d\n", min);
+        fprintf(stdout, "Distance to Furthest Null Child: %d\n", height);
+        fprintf(stdout, "Average Depth by Frequency: %.2f\n", sum / weight);
+    }
+    fprintf(stdout, "Number of Trees: %d\n", nameCount);
+    for (i = 0; i < nameCount; i++)
+        fprintf(stdout, "Tree \"%s\": %d nodes, null children at %d to %d, average depth %.2f\n",
+                names[i].name, names[i].tree->size, st[i].min == -1 ? 0 : st[i].min, st[i].height, st[i].depth);
+    reportArena(arena, stdout);
+    free(st);
+}
+
+Node* newNode(char* str)
+{
+    return arena ? arenaNode(str, arena) : createNode(str);
+}
+
+void queryBST(char instruction, char* key, FILE* out)
+{
+    switch (instruction)
+    {
+        case 'f':
+            showFreq(key, out, b);
+            break;
+        case 's':
+            showTree(out, b);
+            break;
+        case 'r':
+            showStats(out, b);
+            break;
+        case 'l':
+            showRange(key, key + strlen(key) + 1, out, b);
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
     }
 }
 
 void runAVLInstructions(char* fname)
 {
+    if(threaded) { pipeFile(fname, 1, applyAVL); return; }
+
     fp = fopen(fname, "r");
     char instruction = readChar(fp);
+
+    while(!feof(fp))
+    {
+        execAVL(instruction, fp);
+        instruction = readChar(fp);
+    }
+}
+
+void execAVL(char instruction, FILE* fp)
+{
+    applyAVL(instruction, readKey(instruction, fp));
+}
+
+void applyAVL(char instruction, char* key)
+{
     Node *n;
-    
+
+    //The ring and query streams only read keys for i, d and f
+    if (!key && (instruction == 'm' || instruction == 'x' || instruction == 'l' || instruction == 'w'))
+    {
+        fprintf(stderr,"Invalid Instruction\n");
+        exit(4);
+    }
+
+    switch (instruction)
+    {
+        case 'i':
+            n = newNode(key);
+            if(n->data != key)
+                free(key);
+            insertAVL(n, a);
+            break;
+        case 'd':
+            n = createNode(key);
+            deleetAVL(n, a);
+            break;
+        case 'f':
+            n = createNode(key);
+            printFreqAVL(n, a);
+            break;
+        case 's':
+            printTreeAVL(a);
+            break;
+        case 'r':
+            printStatsAVL(a);
+            break;
+        case 'c':
+            printCounters(a->out);
+            resetCounters();
+            break;
+        case 'm':
+            mergeAVL(key);
+            free(key);
+            break;
+        case 'x':
+            deleetRangeAVL(key, key + strlen(key) + 1, a);
+            free(key);
+            break;
+        case 'l':
+            showRangeAVL(key, key + strlen(key) + 1, a->out, a);
+            free(key);
+            break;
+        case 'w':
+            compactAVL(a);
+            if (writePacked(a->root, key) < 0)
+                fprintf(stderr,"Invalid File Name\n");
+            free(key);
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+}
+
+void queryAVL(char instruction, char* key, FILE* out)
+{
+    switch (instruction)
+    {
+        case 'f':
+            showFreqAVL(key, out, a);
+            break;
+        case 's':
+            showTreeAVL(out, a);
+            break;
+        case 'r':
+            showStatsAVL(out, a);
+            break;
+        case 'l':
+            showRangeAVL(key, key + strlen(key) + 1, out, a);
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+}
+
+void buildPAVL(char* fname)
+{
+    if(threaded) { pipeFile(fname, 0, applyPAVL); return; }
+    if(gathered) { buildCorpora(addPAVL); return; }
+
+    fp = fopen(fname, "r");
+    char *str = readStream(fp);
+
+    while(!feof(fp))
+    {
+        if(strcmp(str, "") != 0)
+            insertPAVL(str, p);
+        free(str);
+        str = readStream(fp);
+    }
+
+    fclose(fp);
+}
+
+void runPAVLInstructions(char* fname)
+{
+    if(threaded) { pipeFile(fname, 1, applyPAVL); joinReader(); return; }
+
+    fp = fopen(fname, "r");
+    char instruction = readChar(fp);
+
     while(!feof(fp))
     {
-        switch (instruction)
+        execPAVL(instruction, fp);
+        instruction = readChar(fp);
+    }
+    joinReader();
+}
+
+void execPAVL(char instruction, FILE* fp)
+{
+    applyPAVL(instruction, readKey(instruction, fp));
+}
+
+void applyPAVL(char instruction, char* key)
+{
+    //The ring only reads keys for i, d and f
+    if (!key && instruction == 'l')
+    {
+        fprintf(stderr,"Invalid Instruction\n");
+        exit(4);
+    }
+
+    switch (instruction)
+    {
+        case 'i':
+            insertPAVL(key, p);
+            free(key);
+            break;
+        case 'd':
+            deleetPAVL(key, p);
+            free(key);
+            break;
+        case 'f':
+            printFreqPAVL(key, p);
+            free(key);
+            break;
+        case 'l':
+            printRangePAVL(key, key + strlen(key) + 1, p);
+            free(key);
+            break;
+        case 's':
+        case 'r':
+            joinReader();
+            startReader(instruction);
+            break;
+        case 'c':
+            //The reader's report on the last version prints first
+            joinReader();
+            printCounters(p->out);
+            resetCounters();
+            break;
+        default:
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+    }
+}
+
+char* readKey(char instruction, FILE* fp)
+{
+    if (instruction == 'i' || instruction == 'd' || instruction == 'f')
+        return readStream(fp);
+    //A file name keeps its case, digits and punctuation
+    if (instruction == 'm' || instruction == 'w')
+        return stringPending(fp) ? readString(fp) : readToken(fp);
+    if (instruction == 'x' || instruction == 'l')
+    {
+        char* lo = readStream(fp);
+        char* hi = readStream(fp);
+        if (!lo || !hi)
         {
-            case 'i':
-                n = createNode(readStream(fp));
-                insertAVL(n, a);
-                break;
-            case 'd':
-                n = createNode(readStream(fp));
-                deleetAVL(n, a);
-                break;
-            case 'f':
-                n = createNode(readStream(fp));
-                printFreqAVL(n, a);
-                break;
-            case 's':
-                printTreeAVL(a);
-                break;
-            case 'r':
-                printStatsAVL(a);
-                break;
-            default:
-                fprintf(stderr,"Invalid Instruction\n");
-                exit(4);
+            fprintf(stderr,"Invalid Instruction\n");
+            exit(4);
+        }
+        char* range = allocate(strlen(lo) + strlen(hi) + 2);
+        strcpy(range, lo);
+        strcpy(range + strlen(lo) + 1, hi);
+        free(lo);
+        free(hi);
+        return range;
+    }
+    return NULL;
+}
+
+void pipeFile(char* fname, int instructions, void (*apply)(char, char *))
+{
+    Ring* r = startRing(fname, instructions, readStream);
+    Batch* batch;
+    int i;
+
+    while ((batch = nextBatch(r)))
+    {
+        for (i = 0; i < batch->count; i++)
+            if (instructions || strcmp(batch->keys[i], "") != 0)
+                apply(batch->ops[i], batch->keys[i]);
+        doneBatch(r);
+    }
+}
+
+int streamFd(char* fname)
+{
+    if (strcmp(fname, "-") == 0)
+        return STDIN_FILENO;
+
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(4);
+    }
+    return fd;
+}
+
+void streamInstructions(int fd, void (*exec)(char, FILE *))
+{
+    size_t size = 4096, used = 0;
+    char* buf = allocate(size);
+    ssize_t got;
+
+    for(;;)
+    {
+        got = read(fd, buf + used, size - used);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        used += got;
+
+        //Run every complete line this read delivered
+        char* line = buf;
+        char* nl;
+        while ((nl = memchr(line, '\n', used - (line - buf))))
+        {
+            runLine(line, nl - line + 1, exec);
+            line = nl + 1;
+        }
+        used -= line - buf;
+        memmove(buf, line, used);
+        if (used == size)
+            buf = reallocate(buf, size *= 2);
+
+        //Nothing more is ready, so the batch is done
+        if (p) joinReader();
+        fflush(stdout);
+    }
+
+    if (used > 0)
+        runLine(buf, used, exec);
+    if (p) joinReader();
+    fflush(stdout);
+    free(buf);
+}
+
+void runLine(char* line, size_t len, void (*exec)(char, FILE *))
+{
+    FILE* lf = fmemopen(line, len, "r");
+    if (!lf) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    char instruction = readChar(lf);
+    while(!feof(lf))
+    {
+        exec(instruction, lf);
+        instruction = readChar(lf);
+    }
+    fclose(lf);
+}
+
+void runProgram(char* fname)
+{
+    double start = seconds();
+    Program* prog = compileInstructions(fname, readStream);
+    double compiledAt = seconds();
+
+    if(treeType == 'b')
+        runBSTProgram(prog, b);
+    else if(treeType == 'p')
+    {
+        runPAVLProgram(prog, p);
+        joinReader();
+    }
+    else
+        runAVLProgram(prog, a);
+
+    fflush(stdout);
+    fprintf(stderr,"compiled %d instructions (%d keys) in %.6f s, executed in %.6f s\n",
+            prog->count, prog->keyCount, compiledAt - start, seconds() - compiledAt);
+}
+
+void runParallel(char* fname, void (*apply)(char, char *), void (*query)(char, char *, FILE *), FILE* out)
+{
+    Run* run = allocate(sizeof(Run));
+    char* key;
+
+    pool = initPool(jobs);
+    run->count = 0;
+    run->query = query;
+
+    fp = fopen(fname, "r");
+    char instruction = readChar(fp);
+
+    while(!feof(fp))
+    {
+        key = readKey(instruction, fp);
+        //With -l, s and r compact the tree first, so they are writes
+        if(instruction == 'f' || instruction == 'l' || (!lazy && (instruction == 'r' || instruction == 's')))
+        {
+            run->ops[run->count] = instruction;
+            run->keys[run->count++] = key;
+            if(run->count == RUN_LIMIT)
+                flushRun(run, out);
+        }
+        else
+        {
+            //Everything read so far must print before the tree changes
+            flushRun(run, out);
+            apply(instruction, key);
         }
         instruction = readChar(fp);
     }
+    flushRun(run, out);
+    fclose(fp);
+    freePool(pool);
+    free(run);
+}
+
+void flushRun(Run* run, FILE* out)
+{
+    int i;
+
+    run->chunks = (run->count + CHUNK_MIN - 1) / CHUNK_MIN;
+    if(run->chunks > 4 * jobs)
+        run->chunks = 4 * jobs;
+
+    //Short runs cost more to hand out than to answer
+    if(jobs == 1 || run->chunks <= 1)
+    {
+        for(i = 0; i < run->count; i++)
+            run->query(run->ops[i], run->keys[i], out);
+    }
+    else
+    {
+        runPool(pool, runChunk, run->chunks, run);
+        for(i = 0; i < run->chunks; i++)
+        {
+            fwrite(run->bufs[i], 1, run->lens[i], out);
+            free(run->bufs[i]);
+        }
+    }
+
+    for(i = 0; i < run->count; i++)
+        free(run->keys[i]);
+    run->count = 0;
+}
+
+void runChunk(int chunk, void* arg)
+{
+    Run* run = arg;
+    int from = (long) run->count * chunk / run->chunks;
+    int to = (long) run->count * (chunk + 1) / run->chunks;
+    FILE* out = open_memstream(&run->bufs[chunk], &run->lens[chunk]);
+    int i;
+
+    if (!out) { fprintf(stderr,"out of memory"); exit(-1); }
+    for(i = from; i < to; i++)
+        run->query(run->ops[i], run->keys[i], out);
+    fclose(out);
+}
+
+double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void startReader(char op)
+{
+    reader.dest = p->out;
+    reader.snap = snapshotPAVL(p);
+    reader.snap->out = open_memstream(&reader.buf, &reader.len);
+    p->out = open_memstream(&reader.held, &reader.hlen);
+    if (!reader.snap->out || !p->out) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    reader.op = op;
+    reader.busy = 1;
+    if (pthread_create(&reader.thread, NULL, readSnapshot, &reader) != 0)
+    {
+        fprintf(stderr,"could not start reader thread\n");
+        exit(5);
+    }
+}
+
+void joinReader(void)
+{
+    if (!reader.busy) {return;}
+
+    pthread_join(reader.thread, NULL);
+    fclose(reader.snap->out);
+    fclose(p->out);
+    p->out = reader.dest;
+
+    fwrite(reader.buf, 1, reader.len, p->out);
+    fwrite(reader.held, 1, reader.hlen, p->out);
+    free(reader.buf);
+    free(reader.held);
+    releasePAVL(reader.snap);
+    reader.busy = 0;
+}
+
+void* readSnapshot(void* arg)
+{
+    Reader* r = arg;
+
+    if (r->op == 's')
+        printTreePAVL(r->snap);
+    else
+        printStatsPAVL(r->snap);
+    return NULL;
 }
 
 char * readStream(FILE *fp)
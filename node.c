@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "node.h"
+#include "scanner.h"
+#include "counters.h"
 
 /* VERSION 1.0
  *
@@ -15,14 +18,19 @@ Node* createNode(char* str)
 {
     Node *n = malloc(sizeof(Node));
     if (n == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+    COUNT_BYTES(sizeof(Node));
     
     n->freq = 1;
-    n->level = 0;
     n->lheight = 0;
     n->rheight = 0;
     n->height = 1;
-    n->data = str;
-    n->next = NULL;
+    if (str && strlen(str) < NODE_INLINE)
+    {
+        strcpy(n->key, str);
+        n->data = n->key;
+    }
+    else
+        n->data = str;
     n->left = NULL;
     n->right = NULL;
     n->parent = NULL;
@@ -30,3 +38,62 @@ Node* createNode(char* str)
     
     return n;
 }
+
+void swapKeys(Node* n, Node* q)
+{
+    char* nData = n->data == n->key ? NULL : n->data;
+    char* qData = q->data == q->key ? NULL : q->data;
+    char key[NODE_INLINE];
+
+    memcpy(key, n->key, NODE_INLINE);
+    memcpy(n->key, q->key, NODE_INLINE);
+    memcpy(q->key, key, NODE_INLINE);
+    n->data = qData ? qData : n->key;
+    q->data = nData ? nData : q->key;
+}
+
+int listRange(Node* n, char* lo, char* hi, FILE* out)
+{
+    int found = 0;
+
+    if(!n)
+        return 0;
+    if(compareKey(lo, n->data) < 0)
+        found += listRange(n->left, lo, hi, out);
+    if(compareKey(lo, n->data) <= 0 && compareKey(n->data, hi) <= 0 && n->freq)
+    {
+        fprintf(out, "\"%s\" has frequency %d\n", n->data, n->freq);
+        found++;
+    }
+    if(compareKey(n->data, hi) < 0)
+        found += listRange(n->right, lo, hi, out);
+    return found;
+}
+
+Node** inorderNodes(Node* root, int* count)
+{
+    int cap = 64, depth = 64, top = 0;
+    Node** sorted = allocate(cap * sizeof(Node *));
+    Node** stack = allocate(depth * sizeof(Node *));
+    Node* n = root;
+
+    //An unbalanced BST can be as deep as it is large, so the stack grows
+    *count = 0;
+    while (n || top > 0)
+    {
+        while (n)
+        {
+            if (top == depth)
+                stack = reallocate(stack, (depth *= 2) * sizeof(Node *));
+            stack[top++] = n;
+            n = n->left;
+        }
+        n = stack[--top];
+        if (*count == cap)
+            sorted = reallocate(sorted, (cap *= 2) * sizeof(Node *));
+        sorted[(*count)++] = n;
+        n = n->right;
+    }
+    free(stack);
+    return sorted;
+}
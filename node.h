@@ -1,6 +1,8 @@
 #ifndef NODE_H
 #define NODE_H
 
+#include <stdio.h>
+
 /* VERSION 1.0
  *
  * node.h    - header file for AVL class
@@ -9,27 +11,50 @@
  *    createNode(char *);
  *      - constructor for a new Node object
  *      - returns a malloc'd Node object initialized with a string
+ *      - a key shorter than NODE_INLINE is copied into the node, so data points
+ *      - into the node itself and a compare costs no extra cache miss; a longer
+ *      - key is kept by pointer.  Either way the caller still owns the string
  *      - usage example: Node* n = createNode("string");
  *
+ *    swapKeys(Node *, Node *);
+ *      - exchanges the keys of two nodes, inline or not
+ *      - usage example: swapKeys(n, q);
+ *
+ *    listRange(Node *, char *, char *, FILE *);
+ *      - writes the words of a BST or AVL subtree from lo to hi in order, with their
+ *      - frequencies, skipping tombstones
+ *      - returns the number written
+ *      - usage example: int found = listRange(tree->root, lo, hi, out);
+ *
+ *    inorderNodes(Node *, int *);
+ *      - collects the nodes of a BST or AVL subtree in key order, with a stack that
+ *      - grows as deep as the tree, so an unbalanced BST is fine
+ *      - returns a malloc'd array of the nodes and sets their count
+ *      - usage example: Node** sorted = inorderNodes(tree->root, &count);
+ *
  */
 
+#define NODE_INLINE 16
+
 typedef struct Node
 {
     char* data;
+    char key[NODE_INLINE];
     int freq;
-    int level;
     int lheight;
     int rheight;
     int height;
     
     struct Node* left;
     struct Node* right;
-    struct Node* next;
     struct Node* parent;
     struct Node* fav;
 } Node;
 
 Node* createNode (char *);
+void swapKeys (Node *, Node *);
+int listRange (Node *, char *, char *, FILE *);
+Node** inorderNodes (Node *, int *);
 
 
 #endif
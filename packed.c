@@ -0,0 +1,368 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "packed.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * packed.c  - c file for the packed dictionary file
+ *           - written by Ben Lindow
+ *
+ *    putVarint(unsigned, FILE *);
+ *      - writes a number seven bits a byte, low bits first
+ *      - returns 1 if written, else 0
+ *      - usage example: ok &= putVarint(len, fp);
+
+ *    getVarint(unsigned char **);
+ *      - reads a number putVarint wrote and steps past it, trusting checkBlocks
+ *      - returns the number
+ *      - usage example: unsigned len = getVarint(&at);
+
+ *    readVarint(unsigned char **, unsigned char *, unsigned *);
+ *      - getVarint for bytes not yet checked, stopping at end
+ *      - returns 1 if a whole number was read, else 0
+ *      - usage example: if (!readVarint(&at, end, &len)) ...
+
+ *    checkBlocks(Packed *);
+ *      - walks every word of every block once, so a lookup never reads past
+ *      - the file or writes past the key buffer
+ *      - returns 1 if every word fits, else 0
+ *      - usage example: if (!checkBlocks(d)) ...
+
+ *    decode(unsigned char **, char *, int *);
+ *      - decodes the next word of a block over the word before it in key
+ *      - usage example: decode(&at, d->key, &freq);
+
+ *    findBlock(char *, Packed *);
+ *      - binary searches the block heads for the last one at or before a word
+ *      - returns the block, -1 if the word comes before every block
+ *      - usage example: int i = findBlock(str, d);
+
+ *    compareHead(char *, int, Packed *);
+ *      - compares a word against the first word of a block
+ *      - returns <0, 0 or >0 like strcmp
+ *      - usage example: int c = compareHead(str, i, d);
+
+ *    blockSize(int, Packed *);
+ *      - returns the number of words in a block, PACK_BLOCK except for the last
+ *      - usage example: int n = blockSize(i, d);
+ */
+
+static int putVarint(unsigned, FILE *);
+static unsigned getVarint(unsigned char **);
+static int readVarint(unsigned char **, unsigned char *, unsigned *);
+static int checkBlocks(Packed *);
+static void decode(unsigned char **, char *, int *);
+static int findBlock(char *, Packed *);
+static int compareHead(char *, int, Packed *);
+static int blockSize(int, Packed *);
+
+int writePacked(Node* root, char* fname)
+{
+    FILE* fp = fopen(fname, "wb");
+    PackedHeader h;
+    Node** sorted;
+    uint64_t* index;
+    char* prev = "";
+    int count, i, shared, len;
+    long at;
+    int ok = 1;
+
+    if (!fp)
+        return -1;
+
+    sorted = inorderNodes(root, &count);
+    memcpy(h.magic, PACK_MAGIC, sizeof(h.magic));
+    h.words = count;
+    h.block = PACK_BLOCK;
+    h.blocks = (count + PACK_BLOCK - 1) / PACK_BLOCK;
+    h.longest = 0;
+    h.keyBytes = 0;
+    h.suffixBytes = 0;
+    index = allocate((h.blocks + 1) * sizeof(uint64_t));
+
+    //The header and index are written again once the blocks are placed
+    ok &= fwrite(&h, sizeof(h), 1, fp) == 1;
+    ok &= fwrite(index, sizeof(uint64_t), h.blocks, fp) == (size_t) h.blocks;
+    for (i = 0; ok && i < count; i++)
+    {
+        char* key = sorted[i]->data;
+        len = strlen(key);
+        if (i % PACK_BLOCK == 0)
+        {
+            ok &= (at = ftell(fp)) >= 0;
+            index[i / PACK_BLOCK] = at;
+            prev = "";
+        }
+        for (shared = 0; prev[shared] && prev[shared] == key[shared]; shared++);
+
+        ok &= putVarint(sorted[i]->freq, fp);
+        ok &= putVarint(shared, fp);
+        ok &= putVarint(len - shared, fp);
+        ok &= fwrite(key + shared, 1, len - shared, fp) == (size_t) (len - shared);
+        if (len > h.longest)
+            h.longest = len;
+        h.keyBytes += len;
+        h.suffixBytes += len - shared;
+        prev = key;
+    }
+
+    rewind(fp);
+    ok &= fwrite(&h, sizeof(h), 1, fp) == 1;
+    ok &= fwrite(index, sizeof(uint64_t), h.blocks, fp) == (size_t) h.blocks;
+    //Buffered bytes only reach the disk here, so a full disk may show up now
+    ok &= fclose(fp) == 0;
+    free(index);
+    free(sorted);
+    return ok ? count : -1;
+}
+
+Packed* openPacked(char* fname)
+{
+    int fd = open(fname, O_RDONLY);
+    struct stat st;
+    Packed* d;
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(PackedHeader))
+    {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    d = allocate(sizeof(Packed));
+    d->size = st.st_size;
+    d->base = mmap(NULL, d->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (d->base == MAP_FAILED)
+    {
+        free(d);
+        return NULL;
+    }
+    d->header = (PackedHeader *) d->base;
+    d->index = (uint64_t *) (d->base + sizeof(PackedHeader));
+    d->out = stdout;
+
+    //Anything else is some other file, or one written by a different build
+    if (memcmp(d->header->magic, PACK_MAGIC, sizeof(d->header->magic)) != 0
+        || d->header->block < 1 || d->header->words < 0 || d->header->longest < 0
+        || (size_t) d->header->longest > d->size
+        || d->header->blocks != (d->header->words + d->header->block - 1) / d->header->block
+        || sizeof(PackedHeader) + d->header->blocks * sizeof(uint64_t) > d->size
+        || !checkBlocks(d))
+    {
+        munmap(d->base, d->size);
+        free(d);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    d->key = allocate(d->header->longest + 1);
+    return d;
+}
+
+int findPacked(char* str, Packed* d)
+{
+    int i = findBlock(str, d);
+    int n, freq;
+    unsigned char* at;
+
+    if (i < 0)
+        return 0;
+
+    at = d->base + d->index[i];
+    for (n = blockSize(i, d); n > 0; n--)
+    {
+        decode(&at, d->key, &freq);
+        int c = strcmp(str, d->key);
+        if (c == 0)
+            return freq;
+        if (c < 0)
+            break;
+    }
+    return 0;
+}
+
+void printFreqPacked(char* str, Packed* d)
+{
+    int freq = findPacked(str, d);
+
+    if (freq)
+        fprintf(d->out, "\"%s\" has frequency %d\n", str, freq);
+    else
+        fprintf(d->out, "The string \"%s\" does not exist.\n", str);
+}
+
+void printRangePacked(char* lo, char* hi, Packed* d)
+{
+    int i = findBlock(lo, d);
+    int found = 0;
+    int n, freq;
+    unsigned char* at;
+
+    //A range before the first head starts in the first block
+    if (i < 0)
+        i = 0;
+    for (; i < d->header->blocks; i++)
+    {
+        at = d->base + d->index[i];
+        for (n = blockSize(i, d); n > 0; n--)
+        {
+            decode(&at, d->key, &freq);
+            if (strcmp(d->key, hi) > 0)
+                goto done;
+            if (strcmp(d->key, lo) >= 0)
+            {
+                fprintf(d->out, "\"%s\" has frequency %d\n", d->key, freq);
+                found++;
+            }
+        }
+    }
+done:
+    if (!found)
+        fprintf(d->out, "No strings from \"%s\" to \"%s\".\n", lo, hi);
+}
+
+void printStatsPacked(Packed* d)
+{
+    fprintf(d->out, "\nNumber of Words in Dictionary: %d\n", d->header->words);
+    fprintf(d->out, "Blocks of %d Words: %d\n", d->header->block, d->header->blocks);
+    fprintf(d->out, "Key Bytes: %lld, Front Coded: %lld\n",
+            (long long) d->header->keyBytes, (long long) d->header->suffixBytes);
+    fprintf(d->out, "File Bytes: %zu\n", d->size);
+}
+
+void closePacked(Packed* d)
+{
+    munmap(d->base, d->size);
+    free(d->key);
+    free(d);
+}
+
+static int putVarint(unsigned x, FILE* fp)
+{
+    while (x >= 0x80)
+    {
+        if (fputc((x & 0x7f) | 0x80, fp) == EOF)
+            return 0;
+        x >>= 7;
+    }
+    return fputc(x, fp) != EOF;
+}
+
+static unsigned getVarint(unsigned char** at)
+{
+    unsigned x = 0;
+    int shift = 0;
+
+    while (**at & 0x80)
+    {
+        x |= (unsigned) (*(*at)++ & 0x7f) << shift;
+        shift += 7;
+    }
+    x |= (unsigned) *(*at)++ << shift;
+    return x;
+}
+
+static int readVarint(unsigned char** at, unsigned char* end, unsigned* x)
+{
+    int shift = 0;
+
+    *x = 0;
+    do
+    {
+        if (*at == end || shift > 28)
+            return 0;
+        *x |= (unsigned) (**at & 0x7f) << shift;
+        shift += 7;
+    } while (*(*at)++ & 0x80);
+    return 1;
+}
+
+static int checkBlocks(Packed* d)
+{
+    unsigned char* end = d->base + d->size;
+    unsigned char* start = d->base + sizeof(PackedHeader) + d->header->blocks * sizeof(uint64_t);
+    unsigned char* at;
+    unsigned freq, shared, len, prev;
+    int i, n;
+
+    for (i = 0; i < d->header->blocks; i++)
+    {
+        if (d->index[i] < (uint64_t) (start - d->base) || d->index[i] >= d->size)
+            return 0;
+        at = d->base + d->index[i];
+        prev = 0;
+        for (n = blockSize(i, d); n > 0; n--)
+        {
+            if (!readVarint(&at, end, &freq) || !readVarint(&at, end, &shared)
+                || !readVarint(&at, end, &len))
+                return 0;
+            //A word may only share what the word before it has, and must fit the key buffer
+            if (shared > prev || len > (unsigned) d->header->longest - shared
+                || len > (size_t) (end - at))
+                return 0;
+            at += len;
+            prev = shared + len;
+        }
+    }
+    return 1;
+}
+
+static void decode(unsigned char** at, char* key, int* freq)
+{
+    *freq = getVarint(at);
+    unsigned shared = getVarint(at);
+    unsigned len = getVarint(at);
+
+    memcpy(key + shared, *at, len);
+    key[shared + len] = 0;
+    *at += len;
+}
+
+static int findBlock(char* str, Packed* d)
+{
+    int lo = 0, hi = d->header->blocks - 1, mid;
+
+    //Lower blocks only ever move up to a head at or before the word
+    while (lo <= hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (compareHead(str, mid, d) < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return hi;
+}
+
+static int compareHead(char* str, int i, Packed* d)
+{
+    unsigned char* at = d->base + d->index[i];
+    getVarint(&at);
+    getVarint(&at);
+    unsigned len = getVarint(&at);
+    size_t n = strlen(str);
+    int c = memcmp(str, at, n < len ? n : len);
+
+    if (c != 0)
+        return c;
+    return n < len ? -1 : n > len;
+}
+
+static int blockSize(int i, Packed* d)
+{
+    int rest = d->header->words - i * d->header->block;
+    return rest < d->header->block ? rest : d->header->block;
+}
@@ -0,0 +1,96 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "node.h"
+
+/* VERSION 1.0
+ *
+ * packed.h  - header file for the packed dictionary file
+ *           - written by Ben Lindow
+ *
+ *    A read-only dictionary of a tree's words and frequencies, in key order,
+ *    front coded in blocks of PACK_BLOCK words: the first word of a block is
+ *    stored whole, and each later word as the length of the prefix it shares
+ *    with the word before it plus the rest of its bytes.  A sparse index
+ *    holds the file offset of every block, so a lookup binary searches the
+ *    block heads and decodes at most one block; a range lookup decodes only
+ *    the blocks it spans.  The file is mapped into memory as is.
+ *
+ *    File layout, native byte order:
+ *      - PackedHeader
+ *      - uint64_t offset of each block from the start of the file
+ *      - the blocks, each word a varint frequency, a varint shared prefix
+ *      - length, a varint suffix length and the suffix bytes
+ *
+ *    writePacked(Node *, char *);
+ *      - writes the words of a tree, BST or AVL, to a dictionary file
+ *      - returns the number of words written, -1 if the file cannot be opened or
+ *      - written in full
+ *      - usage example: writePacked(tree->root, "words.dict");
+ *
+ *    openPacked(char *);
+ *      - maps a dictionary file, checking every block so no lookup can run off it
+ *      - returns a malloc'd dictionary object, NULL if the file is missing or not a
+ *      - dictionary, with errno EINVAL if it is there but not a whole dictionary
+ *      - usage example: Packed* d = openPacked("words.dict");
+ *
+ *    findPacked(char *, Packed *);
+ *      - looks up a word
+ *      - returns its frequency, 0 if it is not in the dictionary
+ *      - usage example: int freq = findPacked(str, d);
+ *
+ *    printFreqPacked(char *, Packed *);
+ *      - prints a word's frequency, as f does for a tree
+ *      - usage example: printFreqPacked(str, d);
+ *
+ *    printRangePacked(char *, char *, Packed *);
+ *      - prints every word from lo to hi, inclusive, with its frequency
+ *      - usage example: printRangePacked("ba", "bz", d);
+ *
+ *    printStatsPacked(Packed *);
+ *      - prints the word and block counts, the bytes of the keys whole and front
+ *      - coded, and the bytes of the file
+ *      - usage example: printStatsPacked(d);
+ *
+ *    closePacked(Packed *);
+ *      - unmaps and frees a dictionary
+ *      - usage example: closePacked(d);
+ *
+ */
+
+#define PACK_BLOCK 16
+#define PACK_MAGIC "TREEDICT"
+
+typedef struct PackedHeader
+{
+    char magic[8];
+    int words;
+    int blocks;
+    int longest;
+    int block;
+    int64_t keyBytes;
+    int64_t suffixBytes;
+} PackedHeader;
+
+typedef struct Packed
+{
+    unsigned char* base;
+    size_t size;
+    PackedHeader* header;
+    uint64_t* index;
+    char* key;
+    FILE* out;
+} Packed;
+
+extern int writePacked(Node *, char *);
+extern Packed* openPacked(char *);
+extern int findPacked(char *, Packed *);
+extern void printFreqPacked(char *, Packed *);
+extern void printRangePacked(char *, char *, Packed *);
+extern void printStatsPacked(Packed *);
+extern void closePacked(Packed *);
+
+#endif
@@ -0,0 +1,485 @@
+//  Copyright © 2016 Benjamin Lindow. All rights reserved.
+//
+
+/* VERSION 1.0
+ *
+ * pavl.c    - c file for Persistent AVL Class
+ *           - written by Ben Lindow
+ *
+ *    Reference counts are only touched with atomic builtins, so a reader
+ *    thread may hold and release a snapshot while the writer thread keeps
+ *    publishing new versions.  Nodes are never modified once published.
+ *
+ *    mkNode(PKey *, int, PNode *, PNode *);
+ *      - builds a new node, taking ownership of the two child references
+ *      - returns the new node with a height computed from its children
+ *      - usage example: PNode* n = mkNode(key, freq, l, r);
+
+ *    retain(PNode *);
+ *      - adds a reference to a node (NULL safe)
+ *      - returns the node passed in
+ *      - usage example: PNode* l = retain(t->left);
+
+ *    release(PNode *);
+ *      - drops a reference to a node and frees it, and its unshared children, at zero
+ *      - usage example: release(oldRoot);
+
+ *    newKey(char *);
+ *      - copies a string into a reference counted key
+ *      - usage example: PKey* k = newKey(str);
+
+ *    balance(PKey *, int, PNode *, PNode *);
+ *      - builds a node from two owned children, rotating if they differ in height by two
+ *      - returns the root of the rebuilt subtree
+ *      - usage example: PNode* n = balance(key, freq, l, r);
+
+ *    put(PNode *, PKey *, int *);
+ *      - path-copying insert, does not consume its subtree argument
+ *      - returns the root of the new version, sets flag if a node was added
+ *      - usage example: PNode* v = put(root, key, &grew);
+
+ *    cut(PNode *, char *);
+ *      - path-copying decrement of a key known to be present
+ *      - returns the root of the new version, with the key removed at zero frequency
+ *      - usage example: PNode* v = cut(root, str);
+
+ *    cutMax(PNode *, PNode **);
+ *      - path-copying removal of the rightmost node in a subtree
+ *      - returns the new subtree root and stores the removed node in the out param
+ *      - usage example: PNode* l = cutMax(t->left, &pred);
+
+ *    find(PNode *, char *);
+ *      - generic search from a root
+ *      - returns a pointer to the node holding the key, else NULL
+ *      - usage example: PNode* n = find(root, str);
+
+ *    heavy(PNode *);
+ *      - determines if a node is left heavy or right heavy
+ *      - returns - if a node is left heavy, + if right, NULL if balanced
+ *      - usage example: char* heav = heavy(node);
+
+ *    getStats(PAVL *);
+ *      - uses tree traversal to gather information and store in tree
+ *      - usage example: getStats(tree);
+
+ *    printNode(PNode *, PNode *, FILE *);
+ *      - prints node information in the printTreeAVL format, given the node's parent
+ *      - usage example: printNode(node, parent, out);
+
+ *    listKeys(PNode *, char *, char *, FILE *);
+ *      - writes the keys of a subtree from lo to hi in order
+ *      - returns the number written
+ *      - usage example: int found = listKeys(tree->root, lo, hi, out);
+
+ *    isEmptyTreePAVL(PAVL *);
+ *      - determines if the tree is empty
+ *      - returns 1 if tree is empty, else 0.
+ *      - usage example: int x = isEmptyTreePAVL(tree);
+ */
+
+#include "pavl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "queue.h"
+#include "counters.h"
+
+static PNode* mkNode(PKey *, int, PNode *, PNode *);
+static PNode* retain(PNode *);
+static void release(PNode *);
+static PKey* newKey(char *);
+static void releaseKey(PKey *);
+static int height(PNode *);
+static PNode* balance(PKey *, int, PNode *, PNode *);
+static PNode* put(PNode *, PKey *, int *);
+static PNode* cut(PNode *, char *);
+static PNode* cutMax(PNode *, PNode **);
+static PNode* find(PNode *, char *);
+static char* heavy(PNode *);
+static void getStats(PAVL *);
+static void printNode(PNode *, PNode *, FILE *);
+static int listKeys(PNode *, char *, char *, FILE *);
+static int isEmptyTreePAVL(PAVL *);
+
+//Set while a delete runs, so balance counts its work as the delete's
+static int cutting;
+
+PAVL* initPAVL(void)
+{
+    PAVL* a = malloc(sizeof(PAVL));
+    if (a == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    a->size = 0;
+    a->height = 0;
+    a->min = -1;
+    a->depth = 0;
+    a->root = NULL;
+    a->out = stdout;
+    return a;
+}
+
+void insertPAVL(char* str, PAVL* a)
+{
+    int grew = 0;
+    PKey* k = newKey(str);
+    PNode* v = put(a->root, k, &grew);
+
+    releaseKey(k);
+    release(a->root);
+    a->root = v;
+    a->size += grew;
+}
+
+void deleetPAVL(char* str, PAVL* a)
+{
+    if(isEmptyTreePAVL(a)) {return;}
+
+    PNode* n = find(a->root, str);
+    if(!n) { fprintf(a->out, "The string \"%s\" does not exist.\n", str); return;}
+
+    if(n->freq == 1)
+        a->size--;
+
+    cutting = 1;
+    PNode* v = cut(a->root, str);
+    cutting = 0;
+    release(a->root);
+    a->root = v;
+}
+
+void printFreqPAVL(char* str, PAVL* a)
+{
+    if(isEmptyTreePAVL(a)) {return;}
+    PNode* n = find(a->root, str);
+
+    if(n)
+        fprintf(a->out, "\"%s\" has frequency %d\n", n->key->str, n->freq);
+    else
+        fprintf(a->out, "The string \"%s\" does not exist.\n", str);
+}
+
+void printRangePAVL(char* lo, char* hi, PAVL* a)
+{
+    if(isEmptyTreePAVL(a)) {return;}
+
+    if(!listKeys(a->root, lo, hi, a->out))
+        fprintf(a->out, "No strings from \"%s\" to \"%s\".\n", lo, hi);
+}
+
+void printTreePAVL(PAVL* a)
+{
+    if(isEmptyTreePAVL(a)) {return;}
+
+    Queue* q = initQueue();
+    Visit v;
+    PNode* n;
+    int level = -1;
+
+    enqueue(a->root, a->root, 0, q);
+
+    while(q->size > 0)
+    {
+        v = dequeue(q);
+        n = v.node;
+
+        if(v.depth != level)
+        {
+            if(level != -1)
+                fprintf(a->out, "\n");
+            fprintf(a->out, "%d:", ++level);
+        }
+        printNode(n, v.parent, a->out);
+
+        if(n->left)
+            enqueue(n->left, n, v.depth + 1, q);
+        if(n->right)
+            enqueue(n->right, n, v.depth + 1, q);
+    }
+    freeQueue(q);
+}
+
+void printStatsPAVL(PAVL* a)
+{
+    if(isEmptyTreePAVL(a)) {return;}
+
+    getStats(a);
+    fprintf(a->out, "\nNumber of Nodes in AVL: %d\n", a->size);
+    fprintf(a->out, "Distance to Closest Null Child: %d\n", a->min);
+    fprintf(a->out, "Distance to Furthest Null Child: %d\n", a->height);
+    fprintf(a->out, "Average Depth by Frequency: %.2f\n", a->depth);
+}
+
+PAVL* snapshotPAVL(PAVL* a)
+{
+    PAVL* s = initPAVL();
+    *s = *a;
+    retain(s->root);
+    return s;
+}
+
+void releasePAVL(PAVL* a)
+{
+    release(a->root);
+    free(a);
+}
+
+static PNode* mkNode(PKey* k, int freq, PNode* l, PNode* r)
+{
+    PNode* n = malloc(sizeof(PNode));
+    if (n == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+    COUNT_BYTES(sizeof(PNode));
+
+    __atomic_add_fetch(&k->refs, 1, __ATOMIC_RELAXED);
+    n->key = k;
+    n->freq = freq;
+    n->refs = 1;
+    n->left = l;
+    n->right = r;
+    n->height = (height(l) > height(r) ? height(l) : height(r)) + 1;
+    return n;
+}
+
+static PNode* retain(PNode* n)
+{
+    if(n)
+        __atomic_add_fetch(&n->refs, 1, __ATOMIC_RELAXED);
+    return n;
+}
+
+static void release(PNode* n)
+{
+    while(n && __atomic_sub_fetch(&n->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        PNode* r = n->right;
+        release(n->left);
+        releaseKey(n->key);
+        free(n);
+        n = r;
+    }
+}
+
+static PKey* newKey(char* str)
+{
+    PKey* k = malloc(sizeof(PKey) + strlen(str) + 1);
+    if (k == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+    COUNT_BYTES(sizeof(PKey) + strlen(str) + 1);
+
+    k->refs = 1;
+    strcpy(k->str, str);
+    return k;
+}
+
+static void releaseKey(PKey* k)
+{
+    if(__atomic_sub_fetch(&k->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(k);
+}
+
+static int height(PNode* n)
+{
+    return n ? n->height : 0;
+}
+
+static PNode* balance(PKey* k, int freq, PNode* l, PNode* r)
+{
+    PNode* n;
+
+    if(cutting) COUNT(deleteFixups); else COUNT(insertFixups);
+    if(height(l) > height(r) + 1)
+    {
+        if(height(l->left) >= height(l->right))
+        {
+            if(cutting) COUNT(deleteLinear); else COUNT(insertLinear);
+            n = mkNode(l->key, l->freq, retain(l->left),
+                       mkNode(k, freq, retain(l->right), r));
+        }
+        else
+        {
+            if(cutting) COUNT(deleteNonlinear); else COUNT(insertNonlinear);
+            n = mkNode(l->right->key, l->right->freq,
+                       mkNode(l->key, l->freq, retain(l->left), retain(l->right->left)),
+                       mkNode(k, freq, retain(l->right->right), r));
+        }
+        release(l);
+    }
+    else if(height(r) > height(l) + 1)
+    {
+        if(height(r->right) >= height(r->left))
+        {
+            if(cutting) COUNT(deleteLinear); else COUNT(insertLinear);
+            n = mkNode(r->key, r->freq,
+                       mkNode(k, freq, l, retain(r->left)), retain(r->right));
+        }
+        else
+        {
+            if(cutting) COUNT(deleteNonlinear); else COUNT(insertNonlinear);
+            n = mkNode(r->left->key, r->left->freq,
+                       mkNode(k, freq, l, retain(r->left->left)),
+                       mkNode(r->key, r->freq, retain(r->left->right), retain(r->right)));
+        }
+        release(r);
+    }
+    else
+        n = mkNode(k, freq, l, r);
+
+    return n;
+}
+
+static PNode* put(PNode* t, PKey* k, int* grew)
+{
+    if(!t)
+    {
+        *grew = 1;
+        return mkNode(k, 1, NULL, NULL);
+    }
+
+    COUNT(visits);
+    int c = compareKey(k->str, t->key->str);
+
+    if(c == 0)
+        return mkNode(t->key, t->freq + 1, retain(t->left), retain(t->right));
+    else if(c < 0)
+        return balance(t->key, t->freq, put(t->left, k, grew), retain(t->right));
+    else
+        return balance(t->key, t->freq, retain(t->left), put(t->right, k, grew));
+}
+
+static PNode* cut(PNode* t, char* str)
+{
+    COUNT(visits);
+    int c = compareKey(str, t->key->str);
+
+    if(c < 0)
+        return balance(t->key, t->freq, cut(t->left, str), retain(t->right));
+    if(c > 0)
+        return balance(t->key, t->freq, retain(t->left), cut(t->right, str));
+
+    if(t->freq > 1)
+        return mkNode(t->key, t->freq - 1, retain(t->left), retain(t->right));
+    if(!t->left)
+        return retain(t->right);
+    if(!t->right)
+        return retain(t->left);
+
+    //Two children, replace with predecessor like doSwap in avl.c
+    PNode* pred;
+    PNode* l = cutMax(t->left, &pred);
+    PNode* n = balance(pred->key, pred->freq, l, retain(t->right));
+    return n;
+}
+
+static PNode* cutMax(PNode* t, PNode** max)
+{
+    COUNT(visits);
+    if(!t->right)
+    {
+        *max = t;
+        return retain(t->left);
+    }
+    return balance(t->key, t->freq, retain(t->left), cutMax(t->right, max));
+}
+
+static PNode* find(PNode* t, char* str)
+{
+    while(t)
+    {
+        COUNT(visits);
+        int c = compareKey(str, t->key->str);
+        if(c < 0)
+            t = t->left;
+        else if(c > 0)
+            t = t->right;
+        else
+            break;
+    }
+    return t;
+}
+
+static char* heavy(PNode* n)
+{
+    if(height(n->left) == height(n->right)) return NULL;
+    if(height(n->left) > height(n->right)) return "-";
+    else return "+";
+}
+
+static void getStats(PAVL* a)
+{
+    Queue* q = initQueue();
+    Visit v;
+    PNode* n;
+    long long sum = 0, weight = 0;
+
+    a->min = -1;
+    enqueue(a->root, a->root, 0, q);
+
+    while(q->size > 0)
+    {
+        v = dequeue(q);
+        n = v.node;
+        sum += (long long) n->freq * v.depth;
+        weight += n->freq;
+        if(!n->left || !n->right)
+        {
+            if(a->min == -1)
+                a->min = v.depth;
+            a->height = v.depth;
+        }
+        if(n->left)
+            enqueue(n->left, n, v.depth + 1, q);
+        if(n->right)
+            enqueue(n->right, n, v.depth + 1, q);
+    }
+    a->depth = (double) sum / weight;
+    freeQueue(q);
+}
+
+static void printNode(PNode* n, PNode* p, FILE* out)
+{
+    fprintf(out, " ");
+    if(!n->left && !n->right)
+        fprintf(out, "=");
+    fprintf(out, "%s", n->key->str);
+    if(heavy(n))
+        fprintf(out, "%s", heavy(n));
+    fprintf(out, "(%s", p->key->str);
+    if(heavy(p))
+        fprintf(out, "%s", heavy(p));
+    fprintf(out, ")%d", n->freq);
+    if(n == p)
+        fprintf(out, "X");
+    else if(p->left == n)
+        fprintf(out, "L");
+    else
+        fprintf(out, "R");
+}
+
+static int listKeys(PNode* t, char* lo, char* hi, FILE* out)
+{
+    int found = 0;
+
+    if(!t)
+        return 0;
+    if(compareKey(lo, t->key->str) < 0)
+        found += listKeys(t->left, lo, hi, out);
+    if(compareKey(lo, t->key->str) <= 0 && compareKey(t->key->str, hi) <= 0)
+    {
+        fprintf(out, "\"%s\" has frequency %d\n", t->key->str, t->freq);
+        found++;
+    }
+    if(compareKey(t->key->str, hi) < 0)
+        found += listKeys(t->right, lo, hi, out);
+    return found;
+}
+
+static int isEmptyTreePAVL(PAVL* a)
+{
+    if(!a->root)
+    {
+        fprintf(a->out, "Empty Tree!\n");
+        return 1;
+    }
+    else
+        return 0;
+}
@@ -0,0 +1,93 @@
+/* VERSION 1.0
+ *
+ * pavl.h    - header file for Persistent AVL class
+ *           - written by Ben Lindow
+ *
+ *    Every mutation path-copies from the root down to the changed node and
+ *    publishes a new root version; untouched subtrees are shared between
+ *    versions and reclaimed by reference counts once no version uses them.
+ *
+ *    initPAVL(void);
+ *      - constructor for a new persistent AVL tree
+ *      - returns a malloc'd tree object
+ *      - usage example: PAVL* p = initPAVL();
+ *
+ *    insertPAVL(char *, PAVL *);
+ *      - inserts a key into the tree, producing a new root version
+ *      - usage example: insertPAVL(str, tree);
+ *
+ *    deleetPAVL(char *, PAVL *);
+ *      - deletes a key from the tree, producing a new root version
+ *      - usage example: deleetPAVL(str, tree);
+ *
+ *    printFreqPAVL(char *, PAVL *);
+ *      - prints the frequency of a key in the tree
+ *      - usage example: printFreqPAVL(str, tree);
+ *
+ *    printRangePAVL(char *, char *, PAVL *);
+ *      - prints every key from lo to hi, inclusive, with its frequency
+ *      - usage example: printRangePAVL("ba", "bz", tree);
+ *
+ *    printTreePAVL(PAVL *);
+ *      - show tree function, same format as printTreeAVL
+ *      - usage example: printTreePAVL(tree);
+ *
+ *    printStatsPAVL(PAVL *);
+ *      - prints distances to shortest null child, furthest null child, total nodes in tree,
+ *      - and the average depth of a key weighted by its frequency
+ *      - usage example: printStatsPAVL(tree);
+ *
+ *    snapshotPAVL(PAVL *);
+ *      - freezes the current version so it can be read while the tree keeps changing
+ *      - returns a tree object that shares the frozen root, writing to the same stream
+ *      - usage example: PAVL* snap = snapshotPAVL(tree);
+ *
+ *    releasePAVL(PAVL *);
+ *      - drops a snapshot (or tree) and reclaims nodes no other version still uses
+ *      - usage example: releasePAVL(snap);
+ *
+ */
+
+#ifndef PAVL_H
+#define PAVL_H
+
+#include <stdio.h>
+
+typedef struct PKey
+{
+    int refs;
+    char str[];
+} PKey;
+
+typedef struct PNode
+{
+    PKey* key;
+    int freq;
+    int height;
+    int refs;
+
+    struct PNode* left;
+    struct PNode* right;
+} PNode;
+
+typedef struct PAVL
+{
+    PNode* root;
+    int height;
+    int min;
+    int size;
+    double depth;
+    FILE* out;
+} PAVL;
+
+extern PAVL* initPAVL(void);
+extern void insertPAVL(char *, PAVL *);
+extern void deleetPAVL(char *, PAVL *);
+extern void printFreqPAVL(char *, PAVL *);
+extern void printRangePAVL(char *, char *, PAVL *);
+extern void printTreePAVL(PAVL *);
+extern void printStatsPAVL(PAVL *);
+extern PAVL* snapshotPAVL(PAVL *);
+extern void releasePAVL(PAVL *);
+
+#endif
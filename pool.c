@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * pool.c    - c file for the worker thread pool
+ *           - written by Ben Lindow
+ *
+ *    work(void *);
+ *      - worker thread body, drains each round it is woken for until the pool stops
+ *      - usage example: pthread_create(&t, NULL, work, pool);
+
+ *    drain(Pool *);
+ *      - runs tasks of the current round until none are left
+ *      - returns the number of tasks this thread ran
+ *      - usage example: int ran = drain(pool);
+ */
+
+static void* work(void *);
+static int drain(Pool *);
+
+Pool* initPool(int threads)
+{
+    Pool* p = allocate(sizeof(Pool));
+    int i;
+
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+    p->round = 0;
+    p->stopping = 0;
+    p->active = 0;
+    p->tasks = 0;
+    p->next = 0;
+    p->finished = 0;
+
+    //The calling thread is one of the pool
+    p->count = threads - 1;
+    p->threads = allocate((p->count + 1) * sizeof(pthread_t));
+    for (i = 0; i < p->count; i++)
+    {
+        if (pthread_create(&p->threads[i], NULL, work, p) != 0)
+        {
+            fprintf(stderr,"could not start worker thread\n");
+            exit(5);
+        }
+    }
+    return p;
+}
+
+void runPool(Pool* p, void (*task)(int, void *), int count, void* arg)
+{
+    pthread_mutex_lock(&p->mutex);
+    p->task = task;
+    p->arg = arg;
+    p->tasks = count;
+    p->next = 0;
+    p->finished = 0;
+    p->round++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->mutex);
+
+    int ran = drain(p);
+
+    //Workers still inside the round would otherwise see the next one's counter
+    pthread_mutex_lock(&p->mutex);
+    p->finished += ran;
+    while (p->finished < p->tasks || p->active > 0)
+        pthread_cond_wait(&p->done, &p->mutex);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+void freePool(Pool* p)
+{
+    int i;
+
+    pthread_mutex_lock(&p->mutex);
+    p->stopping = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->mutex);
+
+    for (i = 0; i < p->count; i++)
+        pthread_join(p->threads[i], NULL);
+    free(p->threads);
+    free(p);
+}
+
+static void* work(void* arg)
+{
+    Pool* p = arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&p->mutex);
+    for(;;)
+    {
+        while (p->round == seen && !p->stopping)
+            pthread_cond_wait(&p->start, &p->mutex);
+        if (p->stopping)
+            break;
+        seen = p->round;
+        p->active++;
+        pthread_mutex_unlock(&p->mutex);
+
+        int ran = drain(p);
+
+        pthread_mutex_lock(&p->mutex);
+        p->finished += ran;
+        p->active--;
+        pthread_cond_broadcast(&p->done);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+static int drain(Pool* p)
+{
+    int ran = 0;
+    int i;
+
+    while ((i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->tasks)
+    {
+        p->task(i, p->arg);
+        ran++;
+    }
+    return ran;
+}
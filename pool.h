@@ -0,0 +1,56 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+/* VERSION 1.0
+ *
+ * pool.h    - header file for the worker thread pool
+ *           - written by Ben Lindow
+ *
+ *    A fixed set of worker threads that sleep until handed a round of
+ *    numbered tasks.  The workers and the calling thread take task numbers
+ *    from one shared counter until none are left, so a round is spread
+ *    over every thread without any per-task locking, and the call returns
+ *    once every task has finished.
+ *
+ *    initPool(int);
+ *      - constructor for a pool of the given number of threads, counting the caller
+ *      - returns a malloc'd pool object
+ *      - usage example: Pool* p = initPool(4);
+ *
+ *    runPool(Pool *, void (*)(int, void *), int, void *);
+ *      - runs task(i, arg) for every i from 0 up to count, spread over the pool
+ *      - returns once all of them have finished
+ *      - usage example: runPool(p, runChunk, chunks, &run);
+ *
+ *    freePool(Pool *);
+ *      - stops the workers and frees the pool
+ *      - usage example: freePool(p);
+ *
+ */
+
+typedef struct Pool
+{
+    pthread_t* threads;
+    int count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned round;
+    int stopping;
+    int active;
+
+    void (*task)(int, void *);
+    void* arg;
+    int tasks;
+    int next;
+    int finished;
+} Pool;
+
+extern Pool* initPool(int);
+extern void runPool(Pool *, void (*)(int, void *), int, void *);
+extern void freePool(Pool *);
+
+#endif
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "program.h"
+#include "scanner.h"
+#include "counters.h"
+
+/* VERSION 1.0
+ *
+ * program.c - c file for compiled instruction programs
+ *           - written by Ben Lindow
+ *
+ *    intern(char *, Program *);
+ *      - looks a key up in the program's key table, adding it if new
+ *      - returns the index of the key; a new string is kept, a repeated one freed
+ *      - usage example: int k = intern(str, prog);
+
+ *    grow(Program *);
+ *      - doubles the intern table and rehashes the keys
+ *      - usage example: grow(prog);
+ */
+
+static int intern(char *, Program *);
+static void grow(Program *);
+
+static int* table;
+static int tableSize;
+
+Program* compileInstructions(char* fname, char* (*read)(FILE *))
+{
+    FILE* fp = fopen(fname, "r");
+    Program* prog = allocate(sizeof(Program));
+    int size = 1024;
+    int i;
+    char* str;
+
+    prog->ops = allocate(size * sizeof(Op));
+    prog->count = 0;
+    prog->keys = NULL;
+    prog->keyCount = 0;
+
+    tableSize = 1024;
+    table = allocate(tableSize * sizeof(int));
+    for (i = 0; i < tableSize; i++)
+        table[i] = -1;
+
+    char instruction = readChar(fp);
+    while(!feof(fp))
+    {
+        if (prog->count == size)
+            prog->ops = reallocate(prog->ops, (size *= 2) * sizeof(Op));
+
+        Op* op = &prog->ops[prog->count++];
+        op->code = instruction;
+        op->key = -1;
+
+        switch (instruction)
+        {
+            case 'i':
+            case 'd':
+            case 'f':
+                str = read(fp);
+                if (!str)
+                {
+                    fprintf(stderr,"Invalid Instruction\n");
+                    exit(4);
+                }
+                op->key = intern(str, prog);
+                break;
+            case 's':
+            case 'r':
+            case 'c':
+                break;
+            default:
+                fprintf(stderr,"Invalid Instruction\n");
+                exit(4);
+        }
+        instruction = readChar(fp);
+    }
+    fclose(fp);
+
+    free(table);
+    table = NULL;
+    return prog;
+}
+
+void runAVLProgram(Program* prog, AVL* a)
+{
+    Op* op = prog->ops;
+    Op* end = op + prog->count;
+    char** keys = prog->keys;
+    char* run[FIND_GROUP];
+    Node* n;
+    int k;
+
+    for (; op < end; op++)
+    {
+        switch (op->code)
+        {
+            case 'i':
+                //A long key is kept by pointer, and compaction frees the keys it drops
+                n = createNode(keys[op->key]);
+                if (n->data != n->key)
+                    n->data = strcpy(allocate(strlen(n->data) + 1), n->data);
+                insertAVL(n, a);
+                //A repeat key leaves its node unlinked
+                if (!n->parent)
+                {
+                    if (n->data != n->key)
+                        free(n->data);
+                    free(n);
+                }
+                break;
+            case 'd':
+            case 'f':
+                //Consecutive lookups descend together in one batch
+                for(k = 0; k < FIND_GROUP && op + k < end && op[k].code == op->code; k++)
+                    run[k] = keys[op[k].key];
+                if(op->code == 'd')
+                    deleetBatchAVL(run, k, a);
+                else
+                    printFreqBatchAVL(run, k, a);
+                op += k - 1;
+                break;
+            case 's':
+                printTreeAVL(a);
+                break;
+            case 'r':
+                printStatsAVL(a);
+                break;
+            case 'c':
+                printCounters(a->out);
+                resetCounters();
+                break;
+        }
+    }
+}
+
+void runBSTProgram(Program* prog, BST* b)
+{
+    Op* op = prog->ops;
+    Op* end = op + prog->count;
+    char** keys = prog->keys;
+    Node probe;
+
+    for (; op < end; op++)
+    {
+        switch (op->code)
+        {
+            case 'i':
+                insert(createNode(keys[op->key]), b);
+                break;
+            case 'd':
+                probe.data = keys[op->key];
+                deleet(&probe, b);
+                break;
+            case 'f':
+                probe.data = keys[op->key];
+                printFreq(&probe, b);
+                break;
+            case 's':
+                printTree(b);
+                break;
+            case 'r':
+                printStats(b);
+                break;
+            case 'c':
+                printCounters(b->out);
+                resetCounters();
+                break;
+        }
+    }
+}
+
+void runPAVLProgram(Program* prog, PAVL* p)
+{
+    Op* op = prog->ops;
+    Op* end = op + prog->count;
+    char** keys = prog->keys;
+
+    for (; op < end; op++)
+    {
+        switch (op->code)
+        {
+            case 'i':
+                insertPAVL(keys[op->key], p);
+                break;
+            case 'd':
+                deleetPAVL(keys[op->key], p);
+                break;
+            case 'f':
+                printFreqPAVL(keys[op->key], p);
+                break;
+            case 's':
+                printTreePAVL(p);
+                break;
+            case 'r':
+                printStatsPAVL(p);
+                break;
+            case 'c':
+                printCounters(p->out);
+                resetCounters();
+                break;
+        }
+    }
+}
+
+static int intern(char* str, Program* prog)
+{
+    if (2 * prog->keyCount >= tableSize)
+        grow(prog);
+
+    unsigned slot = hashString(str) & (tableSize - 1);
+    while (table[slot] != -1)
+    {
+        if (strcmp(prog->keys[table[slot]], str) == 0)
+        {
+            free(str);
+            return table[slot];
+        }
+        slot = (slot + 1) & (tableSize - 1);
+    }
+
+    if ((prog->keyCount & (prog->keyCount - 1)) == 0)
+        prog->keys = reallocate(prog->keys, (prog->keyCount ? 2 * prog->keyCount : 1) * sizeof(char *));
+    prog->keys[prog->keyCount] = str;
+    table[slot] = prog->keyCount;
+    return prog->keyCount++;
+}
+
+static void grow(Program* prog)
+{
+    int* old = table;
+    int oldSize = tableSize;
+    int i;
+
+    tableSize *= 2;
+    table = allocate(tableSize * sizeof(int));
+    for (i = 0; i < tableSize; i++)
+        table[i] = -1;
+
+    for (i = 0; i < oldSize; i++)
+    {
+        if (old[i] == -1) continue;
+        unsigned slot = hashString(prog->keys[old[i]]) & (tableSize - 1);
+        while (table[slot] != -1)
+            slot = (slot + 1) & (tableSize - 1);
+        table[slot] = old[i];
+    }
+    free(old);
+}
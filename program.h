@@ -0,0 +1,58 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdio.h>
+
+#include "avl.h"
+#include "bst.h"
+#include "pavl.h"
+
+/* VERSION 1.0
+ *
+ * program.h - header file for compiled instruction programs
+ *           - written by Ben Lindow
+ *
+ *    An instruction file is parsed once into an array of opcodes whose keys
+ *    are interned, so every occurrence of a word shares one string and is
+ *    referred to by index.  The run functions then execute the array in a
+ *    tight loop with no I/O or parsing left on the tree path.
+ *
+ *    compileInstructions(char *, char *(*)(FILE *));
+ *      - parses a whole instruction file into a program, reading keys with the given reader
+ *      - returns a malloc'd program object
+ *      - usage example: Program* prog = compileInstructions(filename, readStream);
+ *
+ *    runAVLProgram(Program *, AVL *);
+ *      - executes a compiled program against an AVL tree
+ *      - usage example: runAVLProgram(prog, tree);
+ *
+ *    runBSTProgram(Program *, BST *);
+ *      - executes a compiled program against a BST tree
+ *      - usage example: runBSTProgram(prog, tree);
+ *
+ *    runPAVLProgram(Program *, PAVL *);
+ *      - executes a compiled program against a persistent AVL tree
+ *      - usage example: runPAVLProgram(prog, tree);
+ *
+ */
+
+typedef struct Op
+{
+    char code;
+    int key;
+} Op;
+
+typedef struct Program
+{
+    Op* ops;
+    int count;
+    char** keys;
+    int keyCount;
+} Program;
+
+extern Program* compileInstructions(char *, char *(*)(FILE *));
+extern void runAVLProgram(Program *, AVL *);
+extern void runBSTProgram(Program *, BST *);
+extern void runPAVLProgram(Program *, PAVL *);
+
+#endif
@@ -9,43 +9,65 @@
  * queue.c   - c file for Queue class
  *           - written by Ben Lindow
  *
+ *    grow(Queue *);
+ *      - doubles the ring buffer, unwrapping the queue to the front of the new one
+ *      - usage example: grow(que);
  */
 
+static void grow(Queue*);
+
 Queue* initQueue(void)
 {
   Queue *q = malloc(sizeof(Queue));
   if (q == 0) { fprintf(stderr,"out of memory"); exit(-1); }
-  q->head = NULL;
-  q->tail = NULL;
+  q->cap = 64;
+  q->items = malloc(q->cap * sizeof(Visit));
+  if (q->items == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+  q->head = 0;
   q->size = 0;
   return q;
 }
 
-void enqueue(Node* n, Queue* q)
+void enqueue(void* n, void* parent, int depth, Queue* q)
 {
-  if(!q->head)
-  {
-    q->head = n;
-    q->tail = n;
-  }
-  else
-  {
-    q->tail->next = n;
-    q->tail = n;
-  }
+  if (q->size == q->cap)
+    grow(q);
+
+  Visit* v = &q->items[(q->head + q->size) & (q->cap - 1)];
+  v->node = n;
+  v->parent = parent;
+  v->depth = depth;
   q->size++;
 }
 
-Node* dequeue(Queue* q)
+Visit dequeue(Queue* q)
+{
+  Visit v = {NULL, NULL, 0};
+
+  if (q->size == 0)
+    return v;
+  v = q->items[q->head];
+  q->head = (q->head + 1) & (q->cap - 1);
+  q->size--;
+  return v;
+}
+
+void freeQueue(Queue* q)
 {
-  if (!q->head)
-    return NULL;
-  else
-  {
-    Node* ptr = q->head;
-    q->head = q->head->next;
-    ptr->next = NULL;
-    q->size--;
-    return ptr;
-  }
+  free(q->items);
+  free(q);
+}
+
+static void grow(Queue* q)
+{
+  Visit* items = malloc(2 * q->cap * sizeof(Visit));
+  if (items == 0) { fprintf(stderr,"out of memory"); exit(-1); }
+
+  int front = q->cap - q->head;
+  memcpy(items, q->items + q->head, front * sizeof(Visit));
+  memcpy(items + front, q->items, q->head * sizeof(Visit));
+  free(q->items);
+  q->items = items;
+  q->head = 0;
+  q->cap *= 2;
 }
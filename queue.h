@@ -1,37 +1,53 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
-#include "node.h"
-
 /* VERSION 1.0
  *
- * node.h    - header file for AVL class
+ * queue.h   - header file for Queue class
  *           - written by Ben Lindow
  *
- *    initiQueue(void);
+ *    A breadth first work list of (node, parent, depth) triples kept in a
+ *    ring buffer that doubles when full.  Nodes are held untyped, so the
+ *    BST, AVL and persistent AVL trees all walk with it, and nothing is
+ *    written to the nodes themselves, so a traversal is a pure read.
+ *
+ *    initQueue(void);
  *      - constructor for a new Queue object
  *      - returns a malloc'd queue object
  *      - usage example: Queue* q = initQueue();
  *
  *    dequeue(Queue *);
  *      - dequeues the head of the queue
- *      - returns a pointer that was at the head of the queue
- *      - usage example: Node* n = dequeue(que);
+ *      - returns the visit that was at the head of the queue
+ *      - usage example: Visit v = dequeue(que);
+ *
+ *    enqueue(void *, void *, int, Queue *);
+ *      - enqueues a node, its parent and its depth to the tail of the queue
+ *      - usage example: enqueue(node->left, node, depth + 1, que);
  *
- *    enqueue(Node *, Queue *);
- *      - enqueues a node to the tail of the list
- *      - usage example: enqueue(node, que);
+ *    freeQueue(Queue *);
+ *      - frees the queue and its buffer
+ *      - usage example: freeQueue(que);
  *
  */
 
+typedef struct Visit
+    {
+      void* node;
+      void* parent;
+      int depth;
+    } Visit;
+
 typedef struct Queue
     {
-      Node* head;
-      Node* tail;
+      Visit* items;
+      int cap;
+      int head;
       int size;
     } Queue;
 
 extern Queue* initQueue(void);
-extern Node* dequeue(Queue*);
-extern void enqueue(Node*, Queue*);
+extern Visit dequeue(Queue*);
+extern void enqueue(void*, void*, int, Queue*);
+extern void freeQueue(Queue*);
 #endif
@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <stdio_ext.h>
+
+#include "ring.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * ring.c    - c file for the tokenizer pipeline
+ *           - written by Ben Lindow
+ *
+ *    produce(void *);
+ *      - reader thread body, fills batches until the file is exhausted
+ *      - usage example: pthread_create(&t, NULL, produce, ring);
+
+ *    claimSlot(Ring *);
+ *      - waits for a free slot
+ *      - returns the batch at the tail of the ring
+ *      - usage example: Batch* b = claimSlot(ring);
+
+ *    publish(Ring *);
+ *      - hands the tail batch to the consumer
+ *      - usage example: publish(ring);
+ */
+
+static void* produce(void *);
+static Batch* claimSlot(Ring *);
+static void publish(Ring *);
+
+Ring* startRing(char* fname, int instructions, char* (*read)(FILE *))
+{
+    Ring* r = allocate(sizeof(Ring));
+
+    r->fp = fopen(fname, "r");
+    if (!r->fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    //Only the reader thread touches the file, so skip stdio's per-character locks
+    __fsetlocking(r->fp, FSETLOCKING_BYCALLER);
+    r->head = 0;
+    r->tail = 0;
+    r->done = 0;
+    r->instructions = instructions;
+    r->read = read;
+
+    if (pthread_create(&r->thread, NULL, produce, r) != 0)
+    {
+        fprintf(stderr,"could not start reader thread\n");
+        exit(5);
+    }
+    return r;
+}
+
+Batch* nextBatch(Ring* r)
+{
+    for(;;)
+    {
+        unsigned tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        if (r->head != tail)
+            return &r->slots[r->head % RING_SLOTS];
+
+        if (__atomic_load_n(&r->done, __ATOMIC_ACQUIRE))
+        {
+            //The last batch may have landed between the two loads
+            if (r->head != __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE))
+                continue;
+            pthread_join(r->thread, NULL);
+            fclose(r->fp);
+            free(r);
+            return NULL;
+        }
+        sched_yield();
+    }
+}
+
+void doneBatch(Ring* r)
+{
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+static void* produce(void* arg)
+{
+    Ring* r = arg;
+    FILE* fp = r->fp;
+    Batch* b = claimSlot(r);
+    char instruction = 0;
+    char* str;
+
+    if (r->instructions)
+        instruction = readChar(fp);
+    else
+        str = r->read(fp);
+
+    while(!feof(fp))
+    {
+        if (b->count == BATCH_SIZE)
+        {
+            publish(r);
+            b = claimSlot(r);
+        }
+
+        if (r->instructions)
+        {
+            b->ops[b->count] = instruction;
+            if (instruction == 'i' || instruction == 'd' || instruction == 'f')
+                b->keys[b->count++] = r->read(fp);
+            else
+                b->keys[b->count++] = NULL;
+            //Leave reporting a bad instruction to the tree thread, in order
+            if (instruction != 's' && instruction != 'r' && instruction != 'c' && !b->keys[b->count - 1])
+                break;
+            instruction = readChar(fp);
+        }
+        else
+        {
+            b->ops[b->count] = 'i';
+            b->keys[b->count++] = str;
+            str = r->read(fp);
+        }
+    }
+
+    if (b->count > 0)
+        publish(r);
+    __atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static Batch* claimSlot(Ring* r)
+{
+    while (r->tail - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == RING_SLOTS)
+        sched_yield();
+
+    Batch* b = &r->slots[r->tail % RING_SLOTS];
+    b->count = 0;
+    return b;
+}
+
+static void publish(Ring* r)
+{
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,62 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/* VERSION 1.0
+ *
+ * ring.h    - header file for the tokenizer pipeline
+ *           - written by Ben Lindow
+ *
+ *    A reader thread reads and normalizes a corpus or instruction file into
+ *    batches of tokens and hands them to the tree thread through a lock-free
+ *    single-producer/single-consumer ring, so I/O and parsing overlap with
+ *    tree updates.  Slots are preallocated; the only shared writes are the
+ *    head and tail counters, published with release/acquire ordering.
+ *
+ *    startRing(char *, int, char *(*)(FILE *));
+ *      - opens the file and starts the reader thread
+ *      - instructions is 0 for a corpus (keys only), 1 for an instruction file
+ *      - returns a malloc'd ring object
+ *      - usage example: Ring* r = startRing(filename, 0, readStream);
+ *
+ *    nextBatch(Ring *);
+ *      - waits for the next filled batch
+ *      - returns the batch, or NULL once the file is exhausted and the ring is freed
+ *      - usage example: Batch* b = nextBatch(r);
+ *
+ *    doneBatch(Ring *);
+ *      - hands the batch returned by nextBatch back to the reader
+ *      - usage example: doneBatch(r);
+ *
+ */
+
+#define BATCH_SIZE 256
+#define RING_SLOTS 64
+
+typedef struct Batch
+{
+    int count;
+    char ops[BATCH_SIZE];
+    char* keys[BATCH_SIZE];
+} Batch;
+
+typedef struct Ring
+{
+    Batch slots[RING_SLOTS];
+    unsigned head;
+    unsigned tail;
+    int done;
+
+    pthread_t thread;
+    FILE* fp;
+    int instructions;
+    char* (*read)(FILE *);
+} Ring;
+
+extern Ring* startRing(char *, int, char *(*)(FILE *));
+extern Batch* nextBatch(Ring *);
+extern void doneBatch(Ring *);
+
+#endif
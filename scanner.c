@@ -4,6 +4,7 @@
 #include <string.h>  /* for strdup */
 
 #include "scanner.h"
+#include "counters.h"
 
 /* VERSION 1.2
  *
@@ -60,6 +61,10 @@
  *    reallocate(void *items,size_t size)
  *      - wrapper for realloc that will generate an out of memory error
  *      - usage example: x = (int *) reallocate(x,sizeof(int) * count);
+ *    hashString(char *str)
+ *      - 32 bit FNV-1a hash of a string, for the hash tables
+ *      - returns the hash value
+ *      - usage example: unsigned h = hashString(str) & mask;
  */
 
 static void skipWhiteSpace(FILE *);
@@ -343,6 +348,7 @@ allocate(size_t size)
         fprintf(stderr,"could not allocate string, out of memory\n");
         exit(3);
         }
+    COUNT_BYTES(size);
 
     return s;
     }
@@ -361,6 +367,15 @@ reallocate(void *s,size_t size)
     return t;
     }
 
+unsigned
+hashString(char *str)
+    {
+    unsigned h = 2166136261u;
+    while (*str)
+        h = (h ^ (unsigned char) *str++) * 16777619u;
+    return h;
+    }
+
 
 void *
 allocateMsg(size_t size,char *where)
@@ -16,4 +16,5 @@ extern char *readToken(FILE *);
 extern char *readLine(FILE *);
 extern void *allocate(size_t);
 extern void *reallocate(void *,size_t);
+extern unsigned hashString(char *);
 #endif
@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "server.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * server.c  - c file for the tree daemon
+ *           - written by Ben Lindow
+ *
+ *    listenOn(char *);
+ *      - creates a non-blocking Unix domain socket bound to path
+ *      - returns the listening socket
+ *      - usage example: int sock = listenOn(path);
+
+ *    acceptAll(int, int);
+ *      - accepts every pending client and registers it with epoll
+ *      - usage example: acceptAll(sock, ep);
+
+ *    readRequests(Conn *);
+ *      - reads everything the client has sent and answers its complete lines
+ *      - returns 0 once the client has hung up, else 1
+ *      - usage example: int open = readRequests(c);
+
+ *    runRequest(char *, size_t, FILE *);
+ *      - runs one instruction line, writing its answer to the batch stream
+ *      - usage example: runRequest(line, len, batch);
+
+ *    validLine(char *, size_t);
+ *      - checks every instruction on a line can be run without the scanner
+ *      - or the tree aborting the daemon
+ *      - returns 1 if valid, else 0
+ *      - usage example: int ok = validLine(line, len);
+
+ *    writeReplies(Conn *, int);
+ *      - writes queued answers, asking epoll for writability if the socket is full
+ *      - returns 0 if the client went away, else 1
+ *      - usage example: int open = writeReplies(c, ep);
+
+ *    closeConn(Conn *);
+ *      - hangs up and frees a client
+ *      - usage example: closeConn(c);
+ */
+
+typedef struct Conn
+{
+    int fd;
+    char* in;
+    size_t inLen;
+    size_t inSize;
+    char* out;
+    size_t outLen;
+    size_t outOff;
+    int waiting;
+} Conn;
+
+static int listenOn(char *);
+static void acceptAll(int, int);
+static int readRequests(Conn *);
+static void runRequest(char *, size_t, FILE *);
+static int validLine(char *, size_t);
+static int writeReplies(Conn *, int);
+static void closeConn(Conn *);
+
+static void (*exec)(char, FILE *);
+static FILE** treeOut;
+static void (*settle)(void);
+
+void serveTree(char* path, void (*run)(char, FILE *), FILE** out, void (*done)(void))
+{
+    struct epoll_event ev, events[64];
+    int sock, ep, n, i;
+
+    exec = run;
+    treeOut = out;
+    settle = done;
+    signal(SIGPIPE, SIG_IGN);
+
+    sock = listenOn(path);
+    ep = epoll_create1(0);
+    if (ep < 0) { perror("epoll_create1"); exit(5); }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(ep, EPOLL_CTL_ADD, sock, &ev);
+
+    for(;;)
+    {
+        n = epoll_wait(ep, events, 64, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { perror("epoll_wait"); exit(5); }
+
+        for(i = 0; i < n; i++)
+        {
+            Conn* c = events[i].data.ptr;
+
+            if (!c)
+            {
+                acceptAll(sock, ep);
+                continue;
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                if (!readRequests(c))
+                {
+                    writeReplies(c, ep);
+                    closeConn(c);
+                    continue;
+                }
+            }
+
+            if (!writeReplies(c, ep))
+                closeConn(c);
+        }
+    }
+}
+
+static int listenOn(char* path)
+{
+    struct sockaddr_un addr;
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) { perror("socket"); exit(5); }
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr,"Socket Path Too Long\n");
+        exit(5);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) { perror("bind"); exit(5); }
+    if (listen(sock, 128) < 0) { perror("listen"); exit(5); }
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+    return sock;
+}
+
+static void acceptAll(int sock, int ep)
+{
+    struct epoll_event ev;
+    int fd;
+
+    while ((fd = accept(sock, NULL, NULL)) >= 0)
+    {
+        Conn* c = allocate(sizeof(Conn));
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+
+        c->fd = fd;
+        c->inSize = 4096;
+        c->in = allocate(c->inSize);
+        c->inLen = 0;
+        c->out = NULL;
+        c->outLen = 0;
+        c->outOff = 0;
+        c->waiting = 0;
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+static int readRequests(Conn* c)
+{
+    ssize_t got;
+    int open = 1;
+
+    //Drain the socket so one batch covers everything pipelined so far
+    for(;;)
+    {
+        if (c->inLen == c->inSize)
+            c->in = reallocate(c->in, c->inSize *= 2);
+        got = read(c->fd, c->in + c->inLen, c->inSize - c->inLen);
+        if (got > 0) { c->inLen += got; continue; }
+        if (got < 0 && errno == EINTR) continue;
+        if (got == 0 || errno != EAGAIN) open = 0;
+        break;
+    }
+
+    char* line = c->in;
+    char* end = c->in + c->inLen;
+    char* nl = memchr(line, '\n', end - line);
+    if (!nl) return open;
+
+    char* batch = NULL;
+    size_t blen = 0;
+    FILE* bf = open_memstream(&batch, &blen);
+    if (!bf) { fprintf(stderr,"out of memory"); exit(-1); }
+    fflush(bf);
+
+    FILE* saved = *treeOut;
+    *treeOut = bf;
+    while (nl)
+    {
+        size_t mark = blen;
+        runRequest(line, nl - line + 1, bf);
+        fflush(bf);
+        //Terminate the answer on a line of its own
+        if (blen > mark && batch[blen - 1] != '\n')
+            fputc('\n', bf);
+        fputs(".\n", bf);
+        line = nl + 1;
+        nl = memchr(line, '\n', end - line);
+    }
+    *treeOut = saved;
+    fclose(bf);
+
+    c->inLen = end - line;
+    memmove(c->in, line, c->inLen);
+
+    if (c->outOff == c->outLen)
+    {
+        free(c->out);
+        c->out = batch;
+        c->outLen = blen;
+        c->outOff = 0;
+    }
+    else
+    {
+        c->out = reallocate(c->out, c->outLen + blen);
+        memcpy(c->out + c->outLen, batch, blen);
+        c->outLen += blen;
+        free(batch);
+    }
+    return open;
+}
+
+static void runRequest(char* line, size_t len, FILE* bf)
+{
+    if (!validLine(line, len))
+    {
+        fprintf(bf, "Invalid Instruction\n");
+        return;
+    }
+
+    FILE* lf = fmemopen(line, len, "r");
+    if (!lf) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    char instruction = readChar(lf);
+    while(!feof(lf))
+    {
+        exec(instruction, lf);
+        if (settle) settle();
+        instruction = readChar(lf);
+    }
+    fclose(lf);
+}
+
+static int validLine(char* line, size_t len)
+{
+    size_t i;
+    int quotes = 0, valid = 1, words;
+    char* key;
+
+    //An unclosed quote would make the scanner abort the daemon
+    for (i = 0; i < len; i++)
+    {
+        if (line[i] == '\\' && quotes % 2) i++;
+        else if (line[i] == '"') quotes++;
+    }
+    if (quotes % 2)
+        return 0;
+
+    //Every instruction on the line is parsed as exec will, so none can exit
+    FILE* lf = fmemopen(line, len, "r");
+    if (!lf) { fprintf(stderr,"out of memory"); exit(-1); }
+
+    char instruction = readChar(lf);
+    while (valid && !feof(lf))
+    {
+        //A switch, since strchr would also match a NUL sent as the instruction
+        switch (instruction)
+        {
+            case 'i':
+            case 'd':
+            case 'f':
+                words = 1;
+                break;
+            case 'l':
+                words = 2;
+                break;
+            case 'r':
+            case 's':
+            case 'c':
+                words = 0;
+                break;
+            default:
+                words = 0;
+                valid = 0;
+        }
+        while (valid && words--)
+        {
+            key = stringPending(lf) ? readString(lf) : readToken(lf);
+            valid = key != NULL;
+            free(key);
+        }
+        instruction = readChar(lf);
+    }
+    fclose(lf);
+    return valid;
+}
+
+static int writeReplies(Conn* c, int ep)
+{
+    struct epoll_event ev;
+    ssize_t put;
+
+    while (c->outOff < c->outLen)
+    {
+        put = write(c->fd, c->out + c->outOff, c->outLen - c->outOff);
+        if (put > 0) { c->outOff += put; continue; }
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0 && errno == EAGAIN) break;
+        return 0;
+    }
+
+    int waiting = c->outOff < c->outLen;
+    if (waiting != c->waiting)
+    {
+        ev.events = waiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+        c->waiting = waiting;
+    }
+    return 1;
+}
+
+static void closeConn(Conn* c)
+{
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
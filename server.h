@@ -0,0 +1,28 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+
+/* VERSION 1.0
+ *
+ * server.h  - header file for the tree daemon
+ *           - written by Ben Lindow
+ *
+ *    Clients connect to a Unix domain socket and send instruction lines in
+ *    the instruction file format.  Any number of lines may be sent without
+ *    waiting (pipelining).  Every instruction is answered with its usual
+ *    output followed by a line holding a single "." so clients can match
+ *    answers to requests; all answers to one read are sent in one write.
+ *
+ *    serveTree(char *, void (*)(char, FILE *), FILE **, void (*)(void));
+ *      - listens on the socket path and runs client instructions with exec
+ *      - out points at the tree's output stream, which is redirected per batch
+ *      - settle, if not NULL, is called after each instruction to finish pending output
+ *      - never returns
+ *      - usage example: serveTree("/tmp/trees.sock", execAVL, &a->out, NULL);
+ *
+ */
+
+extern void serveTree(char *, void (*)(char, FILE *), FILE **, void (*)(void));
+
+#endif
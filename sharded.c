@@ -0,0 +1,497 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio_ext.h>
+
+#include "sharded.h"
+#include "scanner.h"
+#include "pool.h"
+
+/* VERSION 1.0
+ *
+ * sharded.c - c file for the key-sharded AVL dictionary
+ *           - written by Ben Lindow
+ *
+ *    cutChunks(Build *, char *, size_t);
+ *      - splits the corpus text into chunks that end on whitespace outside any quoted string
+ *      - usage example: cutChunks(build, text, len);
+
+ *    tokenize(int, void *);
+ *      - pool task that reads the distinct keys of one chunk in order of first
+ *      - appearance, counting repeats in a hash table instead of keeping them
+ *      - usage example: runPool(pool, tokenize, build->count, build);
+
+ *    count(Chunk *, char *, int **, unsigned *);
+ *      - adds one appearance of a key to a chunk, growing its table as it fills
+ *      - usage example: count(c, str, &table, &mask);
+
+ *    placeBounds(Build *);
+ *      - samples keys evenly across the corpus and sets the shard bounds to its quantiles
+ *      - usage example: placeBounds(build);
+
+ *    route(int, void *);
+ *      - pool task that groups one chunk's keys by shard, keeping their order
+ *      - usage example: runPool(pool, route, build->count, build);
+
+ *    grow(int, void *);
+ *      - pool task that inserts every chunk's keys for one shard, in file order,
+ *      - each with its count in the chunk; repeats never change a tree's shape
+ *      - usage example: runPool(pool, grow, k->count, build);
+
+ *    shardIndex(char *, Sharded *);
+ *      - binary searches the bounds for the shard a key belongs in
+ *      - returns the shard's number
+ *      - usage example: int s = shardIndex(str, k);
+
+ *    isEmptySharded(Sharded *);
+ *      - determines if every shard is empty
+ *      - returns 1 if so, else 0
+ *      - usage example: if (isEmptySharded(k)) ...
+
+ *    compareKeys(const void *, const void *);
+ *      - qsort comparison for an array of strings
+ *      - usage example: qsort(keys, n, sizeof(char *), compareKeys);
+ */
+
+typedef struct Chunk
+{
+    char* text;
+    size_t len;
+    char** keys;
+    int* counts;
+    int count;
+    int* starts;
+    int* routed;
+} Chunk;
+
+typedef struct Build
+{
+    Sharded* k;
+    Chunk* chunks;
+    int count;
+    char* (*read)(FILE *);
+} Build;
+
+static void cutChunks(Build *, char *, size_t);
+static void tokenize(int, void *);
+static void count(Chunk *, char *, int **, unsigned *);
+static void placeBounds(Build *);
+static void route(int, void *);
+static void grow(int, void *);
+static int shardIndex(char *, Sharded *);
+static int isEmptySharded(Sharded *);
+static int compareKeys(const void *, const void *);
+
+Sharded* initSharded(int count)
+{
+    Sharded* k = allocate(sizeof(Sharded));
+    int i;
+
+    k->count = count;
+    k->out = stdout;
+    k->shards = allocate(count * sizeof(AVL *));
+    k->bounds = allocate(count * sizeof(char *));
+    for (i = 0; i < count; i++)
+    {
+        k->shards[i] = initAVL();
+        k->bounds[i] = NULL;
+    }
+    return k;
+}
+
+void buildSharded(char* fname, int threads, char* (*read)(FILE *), Sharded* k)
+{
+    Build build;
+    Pool* pool = initPool(threads);
+    FILE* fp = fopen(fname, "r");
+    long len;
+    int i;
+
+    if (!fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = allocate(len + 1);
+    if (fread(text, 1, len, fp) != (size_t) len)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    fclose(fp);
+
+    build.k = k;
+    build.read = read;
+    build.count = 4 * threads;
+    build.chunks = allocate(build.count * sizeof(Chunk));
+    cutChunks(&build, text, len);
+
+    runPool(pool, tokenize, build.count, &build);
+    placeBounds(&build);
+    runPool(pool, route, build.count, &build);
+    runPool(pool, grow, k->count, &build);
+
+    for (i = 0; i < build.count; i++)
+    {
+        free(build.chunks[i].keys);
+        free(build.chunks[i].counts);
+        free(build.chunks[i].starts);
+        free(build.chunks[i].routed);
+    }
+    free(build.chunks);
+    free(text);
+    freePool(pool);
+}
+
+void deleetSharded(Node* n, Sharded* k)
+{
+    AVL* t = shardOf(n->data, k);
+
+    //One shard can be empty while others still hold keys
+    if (isEmptySharded(k))
+        fprintf(k->out, "Empty Tree!\n");
+    else if (!t->root)
+        fprintf(k->out, "The string \"%s\" does not exist.\n", n->data);
+    else
+        deleetAVL(n, t);
+}
+
+void printFreqSharded(Node* n, Sharded* k)
+{
+    AVL* t = shardOf(n->data, k);
+
+    if (isEmptySharded(k))
+        fprintf(k->out, "Empty Tree!\n");
+    else if (!t->root)
+        fprintf(k->out, "The string \"%s\" does not exist.\n", n->data);
+    else
+        printFreqAVL(n, t);
+}
+
+void deleetRangeSharded(char* lo, char* hi, Sharded* k)
+{
+    int i;
+
+    if (isEmptySharded(k)) { fprintf(k->out, "Empty Tree!\n"); return; }
+
+    //Only the shards from lo's through hi's can hold keys in the range
+    if (strcmp(lo, hi) <= 0)
+    {
+        for (i = 0; k->shards[i] != shardOf(lo, k); i++);
+        do
+        {
+            if (k->shards[i]->root)
+                deleetRangeAVL(lo, hi, k->shards[i]);
+        } while (k->shards[i++] != shardOf(hi, k));
+    }
+}
+
+AVL* shardOf(char* str, Sharded* k)
+{
+    return k->shards[shardIndex(str, k)];
+}
+
+static int shardIndex(char* str, Sharded* k)
+{
+    int lo = 0, hi = k->count - 1;
+
+    //The first shard whose upper bound is past the key
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (strcmp(str, k->bounds[mid]) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+void printTreeSharded(Sharded* k)
+{
+    int i;
+
+    for (i = 0; i < k->count; i++)
+    {
+        fprintf(k->out, "Shard %d:\n", i);
+        showTreeAVL(k->out, k->shards[i]);
+        fprintf(k->out, "\n");
+    }
+}
+
+void printRangeSharded(char* lo, char* hi, Sharded* k)
+{
+    int found = 0, i;
+
+    if (isEmptySharded(k)) { fprintf(k->out, "Empty Tree!\n"); return; }
+
+    //Only the shards from lo's through hi's can hold keys in the range
+    if (strcmp(lo, hi) <= 0)
+    {
+        for (i = 0; k->shards[i] != shardOf(lo, k); i++);
+        do
+            found += listRange(k->shards[i]->root, lo, hi, k->out);
+        while (k->shards[i++] != shardOf(hi, k));
+    }
+    if (!found)
+        fprintf(k->out, "No strings from \"%s\" to \"%s\".\n", lo, hi);
+}
+
+void printStatsSharded(Sharded* k)
+{
+    Stats* st = allocate(k->count * sizeof(Stats));
+    long long weight = 0;
+    double sum = 0;
+    int size = 0, min = -1, height = 0;
+    int i;
+
+    for (i = 0; i < k->count; i++)
+    {
+        statsAVL(k->shards[i], &st[i]);
+        if (st[i].min == -1)
+            continue;
+        size += k->shards[i]->size;
+        weight += st[i].weight;
+        sum += st[i].depth * st[i].weight;
+        if (min == -1 || st[i].min < min)
+            min = st[i].min;
+        if (st[i].height > height)
+            height = st[i].height;
+    }
+
+    if (min == -1)
+        fprintf(k->out, "Empty Tree!\n");
+    else
+    {
+        fprintf(k->out, "\nNumber of Nodes in AVL: %d\n", size);
+        fprintf(k->out, "Distance to Closest Null Child: %d\n", min);
+        fprintf(k->out, "Distance to Furthest Null Child: %d\n", height);
+        fprintf(k->out, "Average Depth by Frequency: %.2f\n", sum / weight);
+        fprintf(k->out, "Number of Shards: %d\n", k->count);
+        for (i = 0; i < k->count; i++)
+            fprintf(k->out, "Shard %d: %d nodes, null children at %d to %d, average depth %.2f\n",
+                    i, k->shards[i]->size, st[i].min == -1 ? 0 : st[i].min, st[i].height, st[i].depth);
+    }
+    free(st);
+}
+
+static void cutChunks(Build* b, char* text, size_t len)
+{
+    size_t pos = 0, start = 0;
+    int quoted = 0, inToken = 0;
+    int i = 0;
+
+    //Follows the scanner: a string opens only where a token would start
+    for (pos = 0; pos < len && i < b->count - 1; pos++)
+    {
+        char ch = text[pos];
+
+        if (quoted)
+        {
+            if (ch == '\\')
+                pos++;
+            else if (ch == '"')
+                quoted = 0;
+        }
+        else if (isspace((unsigned char) ch))
+        {
+            inToken = 0;
+            if (pos >= len * (i + 1) / b->count)
+            {
+                b->chunks[i].text = text + start;
+                b->chunks[i++].len = pos + 1 - start;
+                start = pos + 1;
+            }
+        }
+        else if (!inToken && ch == '"')
+            quoted = 1;
+        else
+            inToken = 1;
+    }
+
+    for (; i < b->count; i++)
+    {
+        b->chunks[i].text = text + start;
+        b->chunks[i].len = len - start;
+        start = len;
+    }
+}
+
+static void tokenize(int i, void* arg)
+{
+    Build* b = arg;
+    Chunk* c = &b->chunks[i];
+    unsigned mask = 1023;
+    int* table = allocate((mask + 1) * sizeof(int));
+
+    memset(table, -1, (mask + 1) * sizeof(int));
+    c->keys = allocate((mask + 1) * sizeof(char *));
+    c->counts = allocate((mask + 1) * sizeof(int));
+    c->count = 0;
+    c->starts = NULL;
+    c->routed = NULL;
+    if (c->len == 0)
+    {
+        free(table);
+        return;
+    }
+
+    FILE* fp = fmemopen(c->text, c->len, "r");
+    if (!fp) { fprintf(stderr,"out of memory"); exit(-1); }
+    //Only this task reads the chunk, so skip stdio's per-character locks
+    __fsetlocking(fp, FSETLOCKING_BYCALLER);
+    char* str = b->read(fp);
+
+    while (!feof(fp))
+    {
+        if (strcmp(str, "") == 0)
+            free(str);
+        else
+            count(c, str, &table, &mask);
+        str = b->read(fp);
+    }
+    fclose(fp);
+    free(table);
+}
+
+static void count(Chunk* c, char* str, int** table, unsigned* mask)
+{
+    unsigned h = hashString(str) & *mask;
+    int i;
+
+    while ((*table)[h] != -1)
+    {
+        if (strcmp(c->keys[(*table)[h]], str) == 0)
+        {
+            c->counts[(*table)[h]]++;
+            free(str);
+            return;
+        }
+        h = (h + 1) & *mask;
+    }
+    (*table)[h] = c->count;
+    c->keys[c->count] = str;
+    c->counts[c->count++] = 1;
+
+    //Keep the table at most half full; the key arrays grow with it
+    if (2 * (unsigned) c->count > *mask)
+    {
+        *mask = 2 * *mask + 1;
+        free(*table);
+        *table = allocate((*mask + 1) * sizeof(int));
+        memset(*table, -1, (*mask + 1) * sizeof(int));
+        c->keys = reallocate(c->keys, (*mask + 1) * sizeof(char *));
+        c->counts = reallocate(c->counts, (*mask + 1) * sizeof(int));
+        for (i = 0; i < c->count; i++)
+        {
+            h = hashString(c->keys[i]) & *mask;
+            while ((*table)[h] != -1)
+                h = (h + 1) & *mask;
+            (*table)[h] = i;
+        }
+    }
+}
+
+static void placeBounds(Build* b)
+{
+    Sharded* k = b->k;
+    char* sample[SHARD_SAMPLE];
+    long total = 0, next = 0, seen = 0;
+    int n = 0, i;
+
+    for (i = 0; i < b->count; i++)
+        total += b->chunks[i].count;
+    long stride = total / SHARD_SAMPLE + 1;
+
+    for (i = 0; i < b->count; i++)
+    {
+        for (; next < seen + b->chunks[i].count && n < SHARD_SAMPLE; next += stride)
+            sample[n++] = b->chunks[i].keys[next - seen];
+        seen += b->chunks[i].count;
+    }
+    qsort(sample, n, sizeof(char *), compareKeys);
+
+    //Keys are freed once they are inlined, so each bound keeps its own copy
+    for (i = 0; i < k->count - 1; i++)
+    {
+        char* q = n ? sample[(long) n * (i + 1) / k->count] : "";
+        k->bounds[i] = allocate(strlen(q) + 1);
+        strcpy(k->bounds[i], q);
+    }
+    //Nothing sorts after the last shard's bound
+    k->bounds[k->count - 1] = NULL;
+}
+
+static void route(int i, void* arg)
+{
+    Build* b = arg;
+    Chunk* c = &b->chunks[i];
+    Sharded* k = b->k;
+    int* shard = allocate((c->count + 1) * sizeof(int));
+    int* at = allocate((k->count + 1) * sizeof(int));
+    int j, s;
+
+    c->starts = allocate((k->count + 1) * sizeof(int));
+    c->routed = allocate((c->count + 1) * sizeof(int));
+    for (s = 0; s <= k->count; s++)
+        c->starts[s] = 0;
+
+    for (j = 0; j < c->count; j++)
+    {
+        shard[j] = shardIndex(c->keys[j], k);
+        c->starts[shard[j] + 1]++;
+    }
+    for (s = 0; s < k->count; s++)
+        c->starts[s + 1] += c->starts[s];
+
+    //A stable counting sort keeps each shard's keys in file order
+    memcpy(at, c->starts, (k->count + 1) * sizeof(int));
+    for (j = 0; j < c->count; j++)
+        c->routed[at[shard[j]]++] = j;
+    free(shard);
+    free(at);
+}
+
+static void grow(int s, void* arg)
+{
+    Build* b = arg;
+    AVL* t = b->k->shards[s];
+    int i, j;
+
+    for (i = 0; i < b->count; i++)
+    {
+        Chunk* c = &b->chunks[i];
+        for (j = c->starts[s]; j < c->starts[s + 1]; j++)
+        {
+            char* key = c->keys[c->routed[j]];
+            Node* n = createNode(key);
+            //An inlined key no longer needs the string
+            if (n->data != key)
+                free(key);
+            //A key already in the shard gains the whole count in one descent
+            n->freq = c->counts[c->routed[j]];
+            insertAVL(n, t);
+        }
+    }
+}
+
+static int isEmptySharded(Sharded* k)
+{
+    int i;
+
+    for (i = 0; i < k->count; i++)
+        if (k->shards[i]->root)
+            return 0;
+    return 1;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+    return strcmp(*(char **) a, *(char **) b);
+}
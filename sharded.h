@@ -0,0 +1,92 @@
+#ifndef SHARDED_H
+#define SHARDED_H
+
+#include <stdio.h>
+
+#include "avl.h"
+
+/* VERSION 1.0
+ *
+ * sharded.h - header file for the key-sharded AVL dictionary
+ *           - written by Ben Lindow
+ *
+ *    A dictionary split by key range over a fixed number of independent AVL
+ *    trees.  Shard i holds the keys from bounds[i - 1] up to, not including,
+ *    bounds[i], so reading the shards in order gives every key in sorted
+ *    order, the same as one tree would.  The bounds are quantiles of a
+ *    sample of the corpus, so the shards come out about the same size.
+ *
+ *    The corpus is cut into chunks at token boundaries and tokenized on a
+ *    thread pool.  Each chunk then sorts its keys by shard, keeping file
+ *    order, and every shard is built by a single owner task from its keys
+ *    in file order.  No shard is ever touched by two threads, so the build
+ *    takes no locks, and each shard has the same shape it would have if its
+ *    keys were inserted one at a time.
+ *
+ *    initSharded(int);
+ *      - constructor for an empty dictionary of the given number of shards
+ *      - returns a malloc'd dictionary object
+ *      - usage example: Sharded* k = initSharded(16);
+ *
+ *    buildSharded(char *, int, char *(*)(FILE *), Sharded *);
+ *      - places the shard bounds and builds the shards from a corpus file
+ *      - using the given number of threads and token reader
+ *      - usage example: buildSharded(filename, 4, readStream, k);
+ *
+ *    shardOf(char *, Sharded *);
+ *      - finds the shard a key belongs in
+ *      - returns the shard's tree
+ *      - usage example: insertAVL(n, shardOf(n->data, k));
+ *
+ *    deleetSharded(Node *, Sharded *);
+ *      - removes one appearance of a key from its shard, printing "Empty Tree!" only
+ *      - when every shard is empty
+ *      - usage example: deleetSharded(node, k);
+ *
+ *    printFreqSharded(Node *, Sharded *);
+ *      - prints a key's frequency from its shard, printing "Empty Tree!" only
+ *      - when every shard is empty
+ *      - usage example: printFreqSharded(node, k);
+ *
+ *    deleetRangeSharded(char *, char *, Sharded *);
+ *      - removes every key from lo to hi, inclusive, reading only the shards
+ *      - the range can reach
+ *      - usage example: deleetRangeSharded("ba", "bz", k);
+ *
+ *    printTreeSharded(Sharded *);
+ *      - shows each shard's tree in turn, under a line naming the shard
+ *      - usage example: printTreeSharded(k);
+ *
+ *    printRangeSharded(char *, char *, Sharded *);
+ *      - prints every key from lo to hi, inclusive, with its frequency, reading only
+ *      - the shards the range can reach
+ *      - usage example: printRangeSharded("ba", "bz", k);
+ *
+ *    printStatsSharded(Sharded *);
+ *      - prints the r report over all shards together, then one line per shard
+ *      - with its node count, null child distances and average depth
+ *      - usage example: printStatsSharded(k);
+ *
+ */
+
+#define SHARD_SAMPLE 4096
+
+typedef struct Sharded
+{
+    AVL** shards;
+    char** bounds;
+    int count;
+    FILE* out;
+} Sharded;
+
+extern Sharded* initSharded(int);
+extern void buildSharded(char *, int, char *(*)(FILE *), Sharded *);
+extern AVL* shardOf(char *, Sharded *);
+extern void deleetSharded(Node *, Sharded *);
+extern void printFreqSharded(Node *, Sharded *);
+extern void deleetRangeSharded(char *, char *, Sharded *);
+extern void printTreeSharded(Sharded *);
+extern void printRangeSharded(char *, char *, Sharded *);
+extern void printStatsSharded(Sharded *);
+
+#endif
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdio_ext.h>
+
+#include "shared.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * shared.c  - c file for shared tree access
+ *           - written by Ben Lindow
+ *
+ *    openStream(char *, Stream *);
+ *      - opens a stream's file and its output buffer
+ *      - usage example: openStream(fname, &streams[i]);
+
+ *    runStream(void *);
+ *      - stream thread body, runs batches under the lock until the file is exhausted
+ *      - usage example: pthread_create(&t, NULL, runStream, stream);
+
+ *    readBatch(Stream *, char *, char **);
+ *      - reads up to STREAM_BATCH instructions and their keys, outside the lock
+ *      - returns the number read, 0 once the file is exhausted
+ *      - usage example: int count = readBatch(s, ops, keys);
+
+ *    now(void);
+ *      - monotonic clock
+ *      - returns the current time in seconds
+ *      - usage example: double t = now();
+ */
+
+static void openStream(char *, Stream *);
+static void* runStream(void *);
+static int readBatch(Stream *, char *, char **);
+static double now(void);
+
+Shared* initShared(void)
+{
+    Shared* s = allocate(sizeof(Shared));
+
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->turn, NULL);
+    s->readers = 0;
+    s->writing = 0;
+    s->waiting = 0;
+    return s;
+}
+
+void readShared(Shared* s)
+{
+    pthread_mutex_lock(&s->mutex);
+    while (s->writing || s->waiting)
+        pthread_cond_wait(&s->turn, &s->mutex);
+    s->readers++;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void doneReading(Shared* s)
+{
+    pthread_mutex_lock(&s->mutex);
+    if (--s->readers == 0)
+        pthread_cond_broadcast(&s->turn);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void writeShared(Shared* s)
+{
+    pthread_mutex_lock(&s->mutex);
+    s->waiting++;
+    while (s->writing || s->readers)
+        pthread_cond_wait(&s->turn, &s->mutex);
+    s->waiting--;
+    s->writing = 1;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void doneWriting(Shared* s)
+{
+    pthread_mutex_lock(&s->mutex);
+    s->writing = 0;
+    pthread_cond_broadcast(&s->turn);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void runStreams(char* writer, char** queries, int count, void (*apply)(char, char *),
+                void (*query)(char, char *, FILE *), FILE** out, char* (*read)(char, FILE *))
+{
+    Shared* lock = initShared();
+    Stream* streams = allocate((count + 1) * sizeof(Stream));
+    FILE* dest = *out;
+    long queried = 0;
+    int i;
+
+    double start = now();
+    for (i = 0; i <= count; i++)
+    {
+        streams[i].lock = lock;
+        streams[i].writer = i == 0;
+        streams[i].apply = apply;
+        streams[i].query = query;
+        streams[i].read = read;
+        streams[i].count = 0;
+        openStream(i == 0 ? writer : queries[i - 1], &streams[i]);
+    }
+    //The writer's instructions print through the tree's own stream
+    *out = streams[0].out;
+
+    for (i = 0; i <= count; i++)
+    {
+        if (pthread_create(&streams[i].thread, NULL, runStream, &streams[i]) != 0)
+        {
+            fprintf(stderr,"could not start stream thread\n");
+            exit(5);
+        }
+    }
+
+    for (i = 0; i <= count; i++)
+        pthread_join(streams[i].thread, NULL);
+    double elapsed = now() - start;
+    *out = dest;
+
+    for (i = 0; i <= count; i++)
+    {
+        fclose(streams[i].fp);
+        fclose(streams[i].out);
+        fwrite(streams[i].buf, 1, streams[i].len, dest);
+        free(streams[i].buf);
+        if (i > 0)
+            queried += streams[i].count;
+    }
+
+    fflush(dest);
+    fprintf(stderr,"streams: %ld writer and %ld query instructions over %d query streams in %.6f s, %.0f instructions/s\n",
+            streams[0].count, queried, count, elapsed, (streams[0].count + queried) / elapsed);
+    free(streams);
+}
+
+static void openStream(char* fname, Stream* s)
+{
+    s->fp = fopen(fname, "r");
+    if (!s->fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(4);
+    }
+    //Only this stream's thread touches the file, so skip stdio's per-character locks
+    __fsetlocking(s->fp, FSETLOCKING_BYCALLER);
+    s->out = open_memstream(&s->buf, &s->len);
+    if (!s->out) { fprintf(stderr,"out of memory"); exit(-1); }
+}
+
+static void* runStream(void* arg)
+{
+    Stream* s = arg;
+    char ops[STREAM_BATCH];
+    char* keys[STREAM_BATCH];
+    int count, i;
+
+    while ((count = readBatch(s, ops, keys)) > 0)
+    {
+        if (s->writer)
+        {
+            writeShared(s->lock);
+            for (i = 0; i < count; i++)
+                s->apply(ops[i], keys[i]);
+            doneWriting(s->lock);
+        }
+        else
+        {
+            readShared(s->lock);
+            for (i = 0; i < count; i++)
+                s->query(ops[i], keys[i], s->out);
+            doneReading(s->lock);
+            for (i = 0; i < count; i++)
+                free(keys[i]);
+        }
+        s->count += count;
+    }
+    return NULL;
+}
+
+static int readBatch(Stream* s, char* ops, char** keys)
+{
+    int count = 0;
+    char instruction;
+
+    while (count < STREAM_BATCH)
+    {
+        instruction = readChar(s->fp);
+        if (feof(s->fp))
+            break;
+        ops[count] = instruction;
+        keys[count++] = s->read(instruction, s->fp);
+    }
+    return count;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
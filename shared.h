@@ -0,0 +1,90 @@
+#ifndef SHARED_H
+#define SHARED_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/* VERSION 1.0
+ *
+ * shared.h  - header file for shared tree access
+ *           - written by Ben Lindow
+ *
+ *    One writer stream and any number of query streams run instruction files
+ *    against the same tree at once, each on its own thread.  A reader-writer
+ *    lock guards the tree: query streams hold it together while they run f, r
+ *    and s through the tree's read-only functions, and the writer holds it
+ *    alone.  Each stream reads and trims up to STREAM_BATCH instructions
+ *    outside the lock and runs them under one acquisition, so writers are
+ *    batched and the lock is not taken once per instruction.  A waiting
+ *    writer holds off new readers so a busy set of query streams cannot
+ *    starve it.
+ *
+ *    initShared(void);
+ *      - constructor for an unlocked tree lock
+ *      - returns a malloc'd lock object
+ *      - usage example: Shared* s = initShared();
+ *
+ *    readShared(Shared *);
+ *      - waits until no writer holds or is waiting for the tree, then shares it
+ *      - usage example: readShared(s);
+ *
+ *    doneReading(Shared *);
+ *      - gives up a shared hold
+ *      - usage example: doneReading(s);
+ *
+ *    writeShared(Shared *);
+ *      - waits until the tree is free, then holds it alone
+ *      - usage example: writeShared(s);
+ *
+ *    doneWriting(Shared *);
+ *      - gives up a writer's hold
+ *      - usage example: doneWriting(s);
+ *
+ *    runStreams(char *, char **, int, void (*)(char, char *),
+ *               void (*)(char, char *, FILE *), FILE **, char *(*)(char, FILE *));
+ *      - runs the writer file with apply and each query file with query, all at once,
+ *      - reading each instruction's key with read
+ *      - query files may only hold f, l, r and s
+ *      - out points at the tree's output stream; each stream's output is held back
+ *      - and written there in command line order, writer first, once all are done
+ *      - reports instructions run and the rate on stderr
+ *      - usage example: runStreams(fname, queries, count, applyAVL, queryAVL, &a->out, readKey);
+ *
+ */
+
+#define STREAM_BATCH 64
+
+typedef struct Shared
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t turn;
+    int readers;
+    int writing;
+    int waiting;
+} Shared;
+
+typedef struct Stream
+{
+    pthread_t thread;
+    Shared* lock;
+    FILE* fp;
+    int writer;
+    void (*apply)(char, char *);
+    void (*query)(char, char *, FILE *);
+    char* (*read)(char, FILE *);
+
+    FILE* out;
+    char* buf;
+    size_t len;
+    long count;
+} Stream;
+
+extern Shared* initShared(void);
+extern void readShared(Shared *);
+extern void doneReading(Shared *);
+extern void writeShared(Shared *);
+extern void doneWriting(Shared *);
+extern void runStreams(char *, char **, int, void (*)(char, char *),
+                       void (*)(char, char *, FILE *), FILE **, char *(*)(char, FILE *));
+
+#endif
@@ -0,0 +1,324 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdio_ext.h>
+
+#include "spill.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * spill.c   - c file for external memory word counting
+ *           - written by Ben Lindow
+ *
+ *    add(char *, Spill *);
+ *      - counts one word, spilling the table first if it has reached its budget
+ *      - usage example: add(str, s);
+
+ *    spill(Spill *, FILE *);
+ *      - sorts the table's words and writes them to dest, then empties the table
+ *      - usage example: spill(s, run);
+
+ *    mergeRuns(FILE **, int, FILE *);
+ *      - merges sorted count files into one, adding the counts of equal words
+ *      - returns the number of distinct words written
+ *      - usage example: long n = mergeRuns(runs, count, dest);
+
+ *    siftDown(Count *, FILE **, int, int);
+ *      - restores the merge heap below a slot whose word has grown
+ *      - usage example: siftDown(heads, files, count, 0);
+
+ *    openRun(void);
+ *      - opens a temporary file for a run with a large buffer
+ *      - returns the file
+ *      - usage example: FILE* run = openRun();
+
+ *    compareCounts(const void *, const void *);
+ *      - qsort comparator, by word
+ *      - usage example: qsort(table, count, sizeof(Count), compareCounts);
+
+ *    now(void);
+ *      - monotonic clock
+ *      - returns the current time in seconds
+ *      - usage example: double t = now();
+ */
+
+static void add(char *, Spill *);
+static void spill(Spill *, FILE *);
+static long mergeRuns(FILE **, int, FILE *);
+static void siftDown(Count *, FILE **, int, int);
+static FILE* openRun(void);
+static int compareCounts(const void *, const void *);
+static double now(void);
+
+long countExternal(char* fname, long budget, char* (*read)(FILE *), FILE* dest)
+{
+    Spill s;
+    FILE* fp = fopen(fname, "r");
+    FILE* run;
+    char* str;
+    long distinct;
+    int spilled;
+    int i;
+
+    if (!fp)
+    {
+        fprintf(stderr,"Invalid File Name\n");
+        exit(3);
+    }
+    __fsetlocking(fp, FSETLOCKING_BYCALLER);
+    double start = now();
+
+    //A quarter of the budget goes to slots, the rest to the words they hold
+    s.capacity = 1024;
+    while (s.capacity * 2 * (long) sizeof(Count) <= budget / 4)
+        s.capacity *= 2;
+    s.table = allocate(s.capacity * sizeof(Count));
+    memset(s.table, 0, s.capacity * sizeof(Count));
+    s.count = 0;
+    s.used = s.capacity * sizeof(Count);
+    s.budget = budget;
+    s.runs = NULL;
+    s.runCount = 0;
+    s.tokens = 0;
+
+    str = read(fp);
+    while (!feof(fp))
+    {
+        if (strcmp(str, "") != 0)
+            add(str, &s);
+        else
+            free(str);
+        str = read(fp);
+    }
+    free(str);
+    fclose(fp);
+
+    //Everything fit, so the table is the only run
+    if (s.runCount == 0)
+    {
+        distinct = s.count;
+        spilled = 0;
+        spill(&s, dest);
+    }
+    else
+    {
+        if (s.count)
+        {
+            run = openRun();
+            spill(&s, run);
+            s.runs = reallocate(s.runs, (s.runCount + 1) * sizeof(FILE *));
+            s.runs[s.runCount++] = run;
+        }
+        free(s.table);
+        s.table = NULL;
+        spilled = s.runCount;
+
+        //Too many open runs at once would run out of file descriptors
+        while (s.runCount > SPILL_FANIN)
+        {
+            run = openRun();
+            mergeRuns(s.runs, SPILL_FANIN, run);
+            for (i = 0; i < SPILL_FANIN; i++)
+                fclose(s.runs[i]);
+            memmove(s.runs, s.runs + SPILL_FANIN, (s.runCount - SPILL_FANIN) * sizeof(FILE *));
+            s.runCount -= SPILL_FANIN;
+            s.runs[s.runCount++] = run;
+        }
+        distinct = mergeRuns(s.runs, s.runCount, dest);
+        for (i = 0; i < s.runCount; i++)
+            fclose(s.runs[i]);
+    }
+
+    fflush(dest);
+    fprintf(stderr,"external: %ld words, %ld distinct, %d runs in %.6f s\n",
+            s.tokens, distinct, spilled, now() - start);
+    free(s.table);
+    free(s.runs);
+    return distinct;
+}
+
+char* readCount(FILE* fp, int* freq)
+{
+    int len;
+    char* key;
+
+    if (fread(freq, sizeof(int), 1, fp) != 1 || fread(&len, sizeof(int), 1, fp) != 1)
+        return NULL;
+    key = allocate(len + 1);
+    if (fread(key, 1, len, fp) != (size_t) len)
+    {
+        fprintf(stderr,"count file is truncated\n");
+        exit(6);
+    }
+    key[len] = 0;
+    return key;
+}
+
+void writeCount(FILE* fp, char* key, int freq)
+{
+    int len = strlen(key);
+
+    fwrite(&freq, sizeof(int), 1, fp);
+    fwrite(&len, sizeof(int), 1, fp);
+    fwrite(key, 1, len, fp);
+}
+
+static void add(char* str, Spill* s)
+{
+    unsigned h = hashString(str);
+    long mask = s->capacity - 1;
+    long i = h & mask;
+    FILE* run;
+
+    s->tokens++;
+    while (s->table[i].key)
+    {
+        if (s->table[i].hash == h && strcmp(s->table[i].key, str) == 0)
+        {
+            s->table[i].freq++;
+            free(str);
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    //A new word that would pass the budget, or crowd the probes, starts a run
+    long cost = strlen(str) + 1 + SPILL_OVERHEAD;
+    if (s->used + cost > s->budget || (s->count + 1) * 2 > s->capacity)
+    {
+        run = openRun();
+        spill(s, run);
+        s->runs = reallocate(s->runs, (s->runCount + 1) * sizeof(FILE *));
+        s->runs[s->runCount++] = run;
+        i = h & mask;
+    }
+
+    s->table[i].key = str;
+    s->table[i].hash = h;
+    s->table[i].freq = 1;
+    s->count++;
+    s->used += cost;
+}
+
+static void spill(Spill* s, FILE* dest)
+{
+    long i, n = 0;
+
+    //Pack the words to the front, then sort them there
+    for (i = 0; i < s->capacity; i++)
+        if (s->table[i].key)
+            s->table[n++] = s->table[i];
+    qsort(s->table, n, sizeof(Count), compareCounts);
+
+    for (i = 0; i < n; i++)
+    {
+        writeCount(dest, s->table[i].key, s->table[i].freq);
+        free(s->table[i].key);
+    }
+    fflush(dest);
+    rewind(dest);
+
+    memset(s->table, 0, s->capacity * sizeof(Count));
+    s->count = 0;
+    s->used = s->capacity * sizeof(Count);
+}
+
+static long mergeRuns(FILE** runs, int count, FILE* dest)
+{
+    Count* heads = allocate(count * sizeof(Count));
+    FILE** files = allocate(count * sizeof(FILE *));
+    long distinct = 0;
+    char* key;
+    long freq;
+    int live = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        heads[live].key = readCount(runs[i], &heads[live].freq);
+        if (heads[live].key)
+            files[live++] = runs[i];
+    }
+    for (i = live / 2 - 1; i >= 0; i--)
+        siftDown(heads, files, live, i);
+
+    while (live)
+    {
+        key = heads[0].key;
+        freq = 0;
+        //Each run holds a word at most once, but several runs may hold it
+        while (live && strcmp(heads[0].key, key) == 0)
+        {
+            freq += heads[0].freq;
+            if (heads[0].key != key)
+                free(heads[0].key);
+            heads[0].key = readCount(files[0], &heads[0].freq);
+            if (!heads[0].key)
+            {
+                heads[0] = heads[--live];
+                files[0] = files[live];
+            }
+            siftDown(heads, files, live, 0);
+        }
+        writeCount(dest, key, freq);
+        free(key);
+        distinct++;
+    }
+
+    fflush(dest);
+    rewind(dest);
+    free(heads);
+    free(files);
+    return distinct;
+}
+
+static void siftDown(Count* heads, FILE** files, int count, int i)
+{
+    Count c;
+    FILE* f;
+    int least;
+
+    for(;;)
+    {
+        least = i;
+        if (2 * i + 1 < count && strcmp(heads[2 * i + 1].key, heads[least].key) < 0)
+            least = 2 * i + 1;
+        if (2 * i + 2 < count && strcmp(heads[2 * i + 2].key, heads[least].key) < 0)
+            least = 2 * i + 2;
+        if (least == i)
+            return;
+        c = heads[i]; heads[i] = heads[least]; heads[least] = c;
+        f = files[i]; files[i] = files[least]; files[least] = f;
+        i = least;
+    }
+}
+
+static FILE* openRun(void)
+{
+    FILE* run = tmpfile();
+
+    if (!run)
+    {
+        fprintf(stderr,"could not open a temporary file\n");
+        exit(6);
+    }
+    setvbuf(run, NULL, _IOFBF, SPILL_BUFFER);
+    __fsetlocking(run, FSETLOCKING_BYCALLER);
+    return run;
+}
+
+static int compareCounts(const void* x, const void* y)
+{
+    return strcmp(((const Count *) x)->key, ((const Count *) y)->key);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,66 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+
+/* VERSION 1.0
+ *
+ * spill.h   - header file for external memory word counting
+ *           - written by Ben Lindow
+ *
+ *    Counts the words of a corpus whose distinct words may not fit in
+ *    memory.  Words are counted in a hash table held to a byte budget; when
+ *    the budget is reached the table is sorted and written out as a run,
+ *    then emptied.  The runs are merged SPILL_FANIN at a time, adding up the
+ *    counts of words found in more than one run, into one sorted file of
+ *    distinct words.  Every file is only ever read or written front to back.
+ *
+ *    A count file is a sequence of records, each an int frequency, an int
+ *    key length and the key's bytes with no terminator, in strcmp order.
+ *
+ *    countExternal(char *, long, char *(*)(FILE *), FILE *);
+ *      - counts the corpus file's words, read with the given token reader, in
+ *      - at most about the given number of bytes, and writes them to dest
+ *      - returns the number of distinct words written
+ *      - usage example: long n = countExternal(fname, 64L << 20, readStream, dest);
+ *
+ *    readCount(FILE *, int *);
+ *      - reads the next record of a count file
+ *      - returns a malloc'd key and sets its frequency, NULL at the end of the file
+ *      - usage example: char* key = readCount(fp, &freq);
+ *
+ *    writeCount(FILE *, char *, int);
+ *      - appends a record to a count file
+ *      - usage example: writeCount(fp, key, freq);
+ *
+ */
+
+#define SPILL_FANIN 64
+#define SPILL_BUFFER (1 << 16)
+#define SPILL_OVERHEAD 16
+
+typedef struct Count
+{
+    char* key;
+    unsigned hash;
+    int freq;
+} Count;
+
+typedef struct Spill
+{
+    Count* table;
+    long capacity;
+    long count;
+    long used;
+    long budget;
+
+    FILE** runs;
+    int runCount;
+    long tokens;
+} Spill;
+
+extern long countExternal(char *, long, char *(*)(FILE *), FILE *);
+extern char* readCount(FILE *, int *);
+extern void writeCount(FILE *, char *, int);
+
+#endif
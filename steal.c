@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "steal.h"
+#include "scanner.h"
+
+/* VERSION 1.0
+ *
+ * steal.c   - c file for the work-stealing scheduler
+ *           - written by Ben Lindow
+ *
+ *    work(void *);
+ *      - thread body, runs tasks from its own deque, else stolen ones, until
+ *      - no task is left anywhere
+ *      - usage example: pthread_create(&t, NULL, work, &workers[i]);
+
+ *    popBottom(Deque *, Task *);
+ *      - takes the newest task from a deque
+ *      - returns 1 if there was one, else 0
+ *      - usage example: if (popBottom(&s->deques[self], &t)) ...
+
+ *    stealTop(Deque *, Task *);
+ *      - takes the oldest task from a deque
+ *      - returns 1 if there was one, else 0
+ *      - usage example: if (stealTop(&s->deques[victim], &t)) ...
+ */
+
+typedef struct Worker
+{
+    Steal* s;
+    int self;
+} Worker;
+
+static void* work(void *);
+static int popBottom(Deque *, Task *);
+static int stealTop(Deque *, Task *);
+
+long runSteal(int threads, void (*run)(Task, int, Steal *), Task first, void* arg)
+{
+    Steal s;
+    pthread_t* ids = allocate(threads * sizeof(pthread_t));
+    Worker* workers = allocate(threads * sizeof(Worker));
+    int i;
+
+    s.count = threads;
+    s.deques = allocate(threads * sizeof(Deque));
+    s.pending = 0;
+    s.steals = 0;
+    s.run = run;
+    s.arg = arg;
+    for (i = 0; i < threads; i++)
+    {
+        s.deques[i].capacity = 64;
+        s.deques[i].tasks = allocate(64 * sizeof(Task));
+        s.deques[i].top = 0;
+        s.deques[i].bottom = 0;
+        pthread_mutex_init(&s.deques[i].lock, NULL);
+        workers[i].s = &s;
+        workers[i].self = i;
+    }
+
+    //The first task is queued before any thief can look for it
+    spawn(&s, 0, first);
+    for (i = 1; i < threads; i++)
+    {
+        if (pthread_create(&ids[i], NULL, work, &workers[i]) != 0)
+        {
+            fprintf(stderr,"could not start worker thread\n");
+            exit(5);
+        }
+    }
+    work(&workers[0]);
+    for (i = 1; i < threads; i++)
+        pthread_join(ids[i], NULL);
+
+    for (i = 0; i < threads; i++)
+    {
+        pthread_mutex_destroy(&s.deques[i].lock);
+        free(s.deques[i].tasks);
+    }
+    free(s.deques);
+    free(workers);
+    free(ids);
+    return s.steals;
+}
+
+void spawn(Steal* s, int self, Task t)
+{
+    Deque* d = &s->deques[self];
+
+    //Counted before it can be seen, so no thread sees zero while it waits
+    __atomic_fetch_add(&s->pending, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom == d->capacity)
+    {
+        memmove(d->tasks, d->tasks + d->top, (d->bottom - d->top) * sizeof(Task));
+        d->bottom -= d->top;
+        d->top = 0;
+        if (d->bottom == d->capacity)
+            d->tasks = reallocate(d->tasks, (d->capacity *= 2) * sizeof(Task));
+    }
+    d->tasks[d->bottom++] = t;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void* work(void* arg)
+{
+    Worker* w = arg;
+    Steal* s = w->s;
+    Task t;
+    int i;
+
+    for(;;)
+    {
+        if (!popBottom(&s->deques[w->self], &t))
+        {
+            for (i = 1; i < s->count; i++)
+                if (stealTop(&s->deques[(w->self + i) % s->count], &t))
+                    break;
+            if (i == s->count)
+            {
+                if (__atomic_load_n(&s->pending, __ATOMIC_SEQ_CST) == 0)
+                    return NULL;
+                sched_yield();
+                continue;
+            }
+            __atomic_fetch_add(&s->steals, 1, __ATOMIC_RELAXED);
+        }
+        s->run(t, w->self, s);
+        __atomic_fetch_sub(&s->pending, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static int popBottom(Deque* d, Task* t)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *t = d->tasks[--d->bottom];
+        found = 1;
+    }
+    if (d->bottom == d->top)
+        d->top = d->bottom = 0;
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static int stealTop(Deque* d, Task* t)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *t = d->tasks[d->top++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
@@ -0,0 +1,62 @@
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <pthread.h>
+
+/* VERSION 1.0
+ *
+ * steal.h   - header file for the work-stealing scheduler
+ *           - written by Ben Lindow
+ *
+ *    Runs a task that may split itself into more tasks, over a fixed number
+ *    of threads.  Each thread keeps its own deque: it pushes the tasks it
+ *    spawns onto the bottom and pops its next task from the bottom, so it
+ *    keeps working on what it split most recently, which is small and warm
+ *    in its cache.  A thread whose deque is empty steals from the top of
+ *    another's, where the oldest and so largest tasks sit, so one steal
+ *    hands over a big share of the work.  The run ends once every task
+ *    spawned has finished.
+ *
+ *    runSteal(int, void (*)(Task, int, Steal *), Task, void *);
+ *      - runs the first task, and every task it spawns, over the given number of
+ *      - threads counting the caller; arg is handed to every task through the scheduler
+ *      - returns the number of tasks stolen
+ *      - usage example: long steals = runSteal(4, buildTask, first, nodes);
+ *
+ *    spawn(Steal *, int, Task);
+ *      - adds a task to the deque of the calling thread, whose number the task was run with
+ *      - usage example: spawn(s, self, left);
+ *
+ */
+
+typedef struct Task
+{
+    void* item;
+    long lo;
+    long count;
+} Task;
+
+typedef struct Deque
+{
+    Task* tasks;
+    int capacity;
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+} Deque;
+
+typedef struct Steal
+{
+    Deque* deques;
+    int count;
+    long pending;
+    long steals;
+
+    void (*run)(Task, int, struct Steal *);
+    void* arg;
+} Steal;
+
+extern long runSteal(int, void (*)(Task, int, Steal *), Task, void *);
+extern void spawn(Steal *, int, Task);
+
+#endif